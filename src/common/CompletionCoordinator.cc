@@ -0,0 +1,83 @@
+#include "common/CompletionCoordinator.h"
+
+Define_Module(CompletionCoordinator);
+
+CompletionCoordinator::~CompletionCoordinator()
+{
+    cancelAndDelete(idleTimer);
+    cancelAndDelete(endTimer);
+}
+
+void CompletionCoordinator::initialize()
+{
+    numVehicles = par("numVehicles");
+    completionGrace = par("completionGrace");
+    idleTimeout = par("idleTimeout");
+
+    completed.reset(numVehicles);
+    lastProgress = simTime();
+    reason = TERMINATED_OTHER;
+
+    idleTimer = new cMessage("idleTimer");
+    endTimer = new cMessage("endTimer");
+}
+
+void CompletionCoordinator::reportStarted(int vehicleId)
+{
+    Enter_Method_Silent();
+
+    // The idle window only starts counting once there is something to wait for
+    if (!idleTimer->isScheduled() && idleTimeout > SimTime(0)) {
+        lastProgress = simTime();
+        scheduleAt(lastProgress + idleTimeout, idleTimer);
+    }
+}
+
+void CompletionCoordinator::reportProgress(int vehicleId)
+{
+    // No rescheduling here: the idle timer re-arms itself from lastProgress when it fires
+    lastProgress = simTime();
+}
+
+void CompletionCoordinator::reportCompleted(int vehicleId)
+{
+    Enter_Method_Silent();
+
+    lastProgress = simTime();
+    if (!completed.insert(vehicleId)) return;
+
+    if (completed.full() && !endTimer->isScheduled()) {
+        // Let the current event finish (e.g. the final implicit-ACK HELLO) before ending the run
+        scheduleAt(simTime() + completionGrace, endTimer);
+    }
+}
+
+void CompletionCoordinator::handleMessage(cMessage *msg)
+{
+    if (msg == endTimer) {
+        terminate(TERMINATED_ALL_COMPLETED);
+    }
+    else if (msg == idleTimer) {
+        simtime_t deadline = lastProgress + idleTimeout;
+        if (simTime() < deadline) scheduleAt(deadline, idleTimer);
+        else if (!endTimer->isScheduled()) terminate(TERMINATED_IDLE);
+    }
+    else {
+        throw cRuntimeError("Unexpected message '%s'", msg->getName());
+    }
+}
+
+void CompletionCoordinator::terminate(TerminationReason why)
+{
+    reason = why;
+    EV_INFO << "Ending run: " << (why == TERMINATED_IDLE ? "no progress" : "all vehicles completed")
+            << ", " << completed.count() << "/" << numVehicles << " completed" << endl;
+    endSimulation();
+}
+
+void CompletionCoordinator::finish()
+{
+    recordScalar("terminationReason", reason);
+    recordScalar("terminationTime", simTime(), "s");
+    recordScalar("completedVehicles", completed.count());
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <omnetpp.h>
+#include "common/PeerSet.h"
+
+using namespace omnetpp;
+
+class CompletionCoordinator : public cSimpleModule
+{
+  public:
+    virtual ~CompletionCoordinator();
+
+    enum TerminationReason
+    {
+        TERMINATED_OTHER = 0,  // sim-time-limit, or nobody called endSimulation() here
+        TERMINATED_ALL_COMPLETED = 1,
+        TERMINATED_IDLE = 2
+    };
+
+    // Called by the apps (from their own event context)
+    void reportStarted(int vehicleId);
+    void reportProgress(int vehicleId);
+    void reportCompleted(int vehicleId);
+
+  protected:
+    virtual void initialize() override;
+    virtual void handleMessage(cMessage *msg) override;
+    virtual void finish() override;
+
+  private:
+    // ====== CONFIG ======
+    int numVehicles = 4;
+    simtime_t completionGrace;
+    simtime_t idleTimeout;
+
+    // ====== STATE ======
+    PeerSet completed;
+    simtime_t lastProgress;
+    cMessage *idleTimer = nullptr;
+    cMessage *endTimer = nullptr;
+    TerminationReason reason = TERMINATED_OTHER;
+
+    void terminate(TerminationReason why);
+};
@@ -0,0 +1,233 @@
+#include "common/GeofenceService.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "inet/mobility/contract/IMobility.h"
+#include "veins_inet/VeinsInetMobility.h"
+
+Define_Module(GeofenceService);
+
+GeofenceService::~GeofenceService()
+{
+    if (subscribed) {
+        cModule *root = getSimulation()->getSystemModule();
+        if (mobilitySignal != -1) root->unsubscribe(mobilitySignal, this);
+        if (vehicleStateSignal != -1) root->unsubscribe(vehicleStateSignal, this);
+    }
+}
+
+void GeofenceService::initialize()
+{
+    cellSize = par("gridCellSize");
+    if (cellSize <= 0) throw cRuntimeError("gridCellSize must be positive");
+
+    parseZones(par("zones").xmlValue());
+    buildGrid();
+
+    // Only listen to the update streams some zone actually depends on
+    bool anyEdgeZone = !edgeZones.empty();
+    bool anyPolygonZone = std::any_of(zones.begin(), zones.end(), [](const Zone& z) { return z.polygonZone; });
+
+    cModule *root = getSimulation()->getSystemModule();
+    if (anyEdgeZone) {
+        vehicleStateSignal = veins::VeinsInetMobility::vehicleStateChangedSignal;
+        root->subscribe(vehicleStateSignal, this);
+    }
+    if (anyPolygonZone) {
+        mobilitySignal = inet::IMobility::mobilityStateChangedSignal;
+        root->subscribe(mobilitySignal, this);
+    }
+    subscribed = true;
+}
+
+void GeofenceService::handleMessage(cMessage *msg)
+{
+    throw cRuntimeError("GeofenceService does not process messages");
+}
+
+void GeofenceService::parseZones(cXMLElement *root)
+{
+    for (cXMLElement *e : root->getChildrenByTagName("zone")) {
+        Zone zone;
+        zone.name = e->getAttribute("id") ? e->getAttribute("id") : "";
+        if (zone.name.empty()) throw cRuntimeError("<zone> without id at %s", e->getSourceLocation());
+        if (findZone(zone.name) != -1) throw cRuntimeError("Duplicate zone '%s' at %s", zone.name.c_str(), e->getSourceLocation());
+
+        int zoneId = zones.size();
+        const char *edges = e->getAttribute("edges");
+        const char *polygon = e->getAttribute("polygon");
+        if ((edges != nullptr) == (polygon != nullptr))
+            throw cRuntimeError("Zone '%s' needs exactly one of 'edges' or 'polygon' at %s", zone.name.c_str(), e->getSourceLocation());
+
+        if (edges) {
+            cStringTokenizer tokenizer(edges);
+            while (tokenizer.hasMoreTokens()) {
+                edgeZones[tokenizer.nextToken()].push_back(zoneId);
+            }
+        }
+        else {
+            zone.polygonZone = true;
+            cStringTokenizer tokenizer(polygon);
+            while (tokenizer.hasMoreTokens()) {
+                std::vector<double> xy = cStringTokenizer(tokenizer.nextToken(), ",").asDoubleVector();
+                if (xy.size() != 2) throw cRuntimeError("Zone '%s': polygon points must be 'x,y' at %s", zone.name.c_str(), e->getSourceLocation());
+                zone.polygon.push_back(inet::Coord(xy[0], xy[1]));
+            }
+            if (zone.polygon.size() < 3) throw cRuntimeError("Zone '%s': polygon needs at least 3 points at %s", zone.name.c_str(), e->getSourceLocation());
+        }
+        zones.push_back(zone);
+    }
+}
+
+void GeofenceService::buildGrid()
+{
+    double minX = INFINITY, minY = INFINITY, maxX = -INFINITY, maxY = -INFINITY;
+    for (const Zone& zone : zones) {
+        for (const inet::Coord& p : zone.polygon) {
+            minX = std::min(minX, p.x);
+            minY = std::min(minY, p.y);
+            maxX = std::max(maxX, p.x);
+            maxY = std::max(maxY, p.y);
+        }
+    }
+    if (minX > maxX) return;  // no polygon zones
+
+    gridX0 = minX;
+    gridY0 = minY;
+    gridCols = (int)std::floor((maxX - minX) / cellSize) + 1;
+    gridRows = (int)std::floor((maxY - minY) / cellSize) + 1;
+    grid.assign(gridCols * gridRows, std::vector<int>());
+
+    for (int zoneId = 0; zoneId < (int)zones.size(); zoneId++) {
+        const Zone& zone = zones[zoneId];
+        if (!zone.polygonZone) continue;
+
+        double zx0 = INFINITY, zy0 = INFINITY, zx1 = -INFINITY, zy1 = -INFINITY;
+        for (const inet::Coord& p : zone.polygon) {
+            zx0 = std::min(zx0, p.x);
+            zy0 = std::min(zy0, p.y);
+            zx1 = std::max(zx1, p.x);
+            zy1 = std::max(zy1, p.y);
+        }
+        int c0 = (int)((zx0 - gridX0) / cellSize), c1 = (int)((zx1 - gridX0) / cellSize);
+        int r0 = (int)((zy0 - gridY0) / cellSize), r1 = (int)((zy1 - gridY0) / cellSize);
+        for (int r = r0; r <= r1; r++) {
+            for (int c = c0; c <= c1; c++) {
+                grid[r * gridCols + c].push_back(zoneId);
+            }
+        }
+    }
+}
+
+int GeofenceService::findZone(const std::string& name) const
+{
+    for (int i = 0; i < (int)zones.size(); i++) {
+        if (zones[i].name == name) return i;
+    }
+    return -1;
+}
+
+void GeofenceService::subscribe(cModule *mobility, IGeofenceListener *listener)
+{
+    Enter_Method_Silent();
+
+    Vehicle& vehicle = vehicles[mobility];
+    if (vehicle.listeners.empty()) vehicle.inside.clear();  // stale entry of a deleted module at the same address
+    vehicle.listeners.push_back(listener);
+
+    // Report the zones the vehicle is in right now
+    if (auto inetmm = dynamic_cast<veins::VeinsInetMobility *>(mobility)) {
+        if (vehicleStateSignal != -1) updateEdgeZones(vehicle, inetmm->getVehicleState().roadId);
+        if (mobilitySignal != -1) updatePolygonZones(vehicle, inetmm->getCurrentPosition());
+    }
+}
+
+void GeofenceService::unsubscribe(cModule *mobility, IGeofenceListener *listener)
+{
+    Enter_Method_Silent();
+
+    auto it = vehicles.find(mobility);
+    if (it == vehicles.end()) return;
+    auto& listeners = it->second.listeners;
+    listeners.erase(std::remove(listeners.begin(), listeners.end(), listener), listeners.end());
+}
+
+void GeofenceService::receiveSignal(cComponent *source, simsignal_t signalID, cObject *obj, cObject *details)
+{
+    auto it = vehicles.find(source);
+    if (it == vehicles.end() || it->second.listeners.empty()) return;
+
+    if (signalID == vehicleStateSignal) {
+        auto inetmm = check_and_cast<veins::VeinsInetMobility *>(obj);
+        updateEdgeZones(it->second, inetmm->getVehicleState().roadId);
+    }
+    else if (signalID == mobilitySignal) {
+        auto mobility = check_and_cast<inet::IMobility *>(obj);
+        updatePolygonZones(it->second, mobility->getCurrentPosition());
+    }
+}
+
+void GeofenceService::updateEdgeZones(Vehicle& vehicle, const std::string& roadId)
+{
+    static const std::vector<int> none;
+    auto it = edgeZones.find(roadId);
+    const std::vector<int>& now = it == edgeZones.end() ? none : it->second;
+
+    // Exits first, then entries; copy since callbacks may change vehicle.inside
+    std::vector<int> before = vehicle.inside;
+    for (int zoneId : before) {
+        if (!zones[zoneId].polygonZone && std::find(now.begin(), now.end(), zoneId) == now.end()) setInside(vehicle, zoneId, false);
+    }
+    for (int zoneId : now) {
+        setInside(vehicle, zoneId, true);
+    }
+}
+
+void GeofenceService::updatePolygonZones(Vehicle& vehicle, const inet::Coord& pos)
+{
+    // Zones overlapping the vehicle's cell, plus the ones it may just have left
+    candidates.clear();
+    int c = (int)std::floor((pos.x - gridX0) / cellSize);
+    int r = (int)std::floor((pos.y - gridY0) / cellSize);
+    if (c >= 0 && c < gridCols && r >= 0 && r < gridRows) candidates = grid[r * gridCols + c];
+    for (int zoneId : vehicle.inside) {
+        if (zones[zoneId].polygonZone && std::find(candidates.begin(), candidates.end(), zoneId) == candidates.end()) candidates.push_back(zoneId);
+    }
+
+    std::vector<int> check;
+    check.swap(candidates);
+    for (int zoneId : check) {
+        setInside(vehicle, zoneId, containsPoint(zones[zoneId].polygon, pos.x, pos.y));
+    }
+    check.swap(candidates);
+}
+
+void GeofenceService::setInside(Vehicle& vehicle, int zoneId, bool nowInside)
+{
+    auto it = std::find(vehicle.inside.begin(), vehicle.inside.end(), zoneId);
+    bool wasInside = it != vehicle.inside.end();
+    if (wasInside == nowInside) return;
+
+    if (nowInside) vehicle.inside.push_back(zoneId);
+    else vehicle.inside.erase(it);
+
+    // Listeners may unsubscribe from the callback
+    std::vector<IGeofenceListener *> listeners = vehicle.listeners;
+    for (IGeofenceListener *listener : listeners) {
+        if (nowInside) listener->zoneEntered(zoneId);
+        else listener->zoneExited(zoneId);
+    }
+}
+
+bool GeofenceService::containsPoint(const std::vector<inet::Coord>& polygon, double x, double y)
+{
+    // Even-odd ray casting
+    bool inside = false;
+    for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++) {
+        const inet::Coord& a = polygon[i];
+        const inet::Coord& b = polygon[j];
+        if ((a.y > y) != (b.y > y) && x < (b.x - a.x) * (y - a.y) / (b.y - a.y) + a.x) inside = !inside;
+    }
+    return inside;
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <omnetpp.h>
+#include "inet/common/geometry/common/Coord.h"
+
+using namespace omnetpp;
+
+// Implemented by apps that subscribe to GeofenceService
+class IGeofenceListener
+{
+  public:
+    virtual ~IGeofenceListener() {}
+    virtual void zoneEntered(int zoneId) = 0;
+    virtual void zoneExited(int zoneId) = 0;
+};
+
+class GeofenceService : public cSimpleModule, public cListener
+{
+  public:
+    virtual ~GeofenceService();
+
+    // Zone id for the name in the zones XML, or -1
+    int findZone(const std::string& name) const;
+    const std::string& getZoneName(int zoneId) const { return zones[zoneId].name; }
+
+    // mobility: the vehicle's VeinsInetMobility module.
+    // Zones the vehicle is already in are reported from within subscribe().
+    void subscribe(cModule *mobility, IGeofenceListener *listener);
+    void unsubscribe(cModule *mobility, IGeofenceListener *listener);
+
+  protected:
+    virtual void initialize() override;
+    virtual void handleMessage(cMessage *msg) override;
+    virtual void receiveSignal(cComponent *source, simsignal_t signalID, cObject *obj, cObject *details) override;
+
+  private:
+    struct Zone
+    {
+        std::string name;
+        bool polygonZone = false;
+        std::vector<inet::Coord> polygon;
+    };
+
+    struct Vehicle
+    {
+        std::vector<IGeofenceListener *> listeners;
+        std::vector<int> inside;  // zone ids, small
+    };
+
+    // ====== CONFIG ======
+    std::vector<Zone> zones;
+    std::unordered_map<std::string, std::vector<int>> edgeZones;  // edge -> edge zones containing it
+    double cellSize = 50;
+    double gridX0 = 0, gridY0 = 0;
+    int gridCols = 0, gridRows = 0;
+    std::vector<std::vector<int>> grid;  // cell -> polygon zones whose bounding box overlaps it
+
+    // ====== STATE ======
+    std::unordered_map<cComponent *, Vehicle> vehicles;  // entries are kept (with no listeners) after unsubscribe
+    std::vector<int> candidates;  // scratch
+    simsignal_t mobilitySignal = -1;
+    simsignal_t vehicleStateSignal = -1;
+    bool subscribed = false;
+
+  private:
+    void parseZones(cXMLElement *root);
+    void buildGrid();
+    static bool containsPoint(const std::vector<inet::Coord>& polygon, double x, double y);
+    void updateEdgeZones(Vehicle& vehicle, const std::string& roadId);
+    void updatePolygonZones(Vehicle& vehicle, const inet::Coord& pos);
+    void setInside(Vehicle& vehicle, int zoneId, bool nowInside);
+};
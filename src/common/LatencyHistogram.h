@@ -0,0 +1,168 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <omnetpp.h>
+
+// Streaming latency histogram with fixed memory, in the style of HdrHistogram.
+// Values are counted in microsecond ticks in log-linear buckets: every power of
+// two is split into 2^SUB_BITS equal sub-buckets, so any recorded value is
+// reported within 1/2^SUB_BITS (about 1.6%) of its true value, from 1us up to
+// 2^MAX_BITS us (about 16.7s). Larger values land in the last bucket; max() stays exact.
+// The 2^SUB_BITS uint32_t counters of a power of two (256 bytes) are only allocated
+// once a value falls into it, so a histogram whose latencies span a few orders of
+// magnitude takes about 1-2 KB instead of the 5 KB of a full one.
+// record() is O(1) and only allocates on the first value of a power of two.
+class LatencyHistogram
+{
+  public:
+    LatencyHistogram() : blocks(NUM_BLOCKS) {}
+
+    void clear()
+    {
+        for (auto& block : blocks) block.clear();
+        numValues = 0;
+        sum = 0;
+        maxTicks = 0;
+    }
+
+    void record(omnetpp::simtime_t latency)
+    {
+        int64_t ticks = latency.inUnit(omnetpp::SIMTIME_US);
+        if (ticks < 0) ticks = 0;
+        int index = indexOf(ticks);
+        std::vector<uint32_t>& block = blocks[index / SUB_COUNT];
+        if (block.empty()) block.assign(SUB_COUNT, 0);
+        block[index % SUB_COUNT]++;
+        numValues++;
+        sum += ticks;
+        if (ticks > maxTicks) maxTicks = ticks;
+    }
+
+    void merge(const LatencyHistogram& other)
+    {
+        for (int b = 0; b < NUM_BLOCKS; b++) {
+            const std::vector<uint32_t>& from = other.blocks[b];
+            if (from.empty()) continue;
+            std::vector<uint32_t>& to = blocks[b];
+            if (to.empty()) to.assign(SUB_COUNT, 0);
+            for (int i = 0; i < SUB_COUNT; i++) to[i] += from[i];
+        }
+        numValues += other.numValues;
+        sum += other.sum;
+        if (other.maxTicks > maxTicks) maxTicks = other.maxTicks;
+    }
+
+    int64_t count() const { return numValues; }
+
+    // Smallest value v such that at least fraction p (0..1) of the values are <= v,
+    // as the upper edge of its bucket
+    omnetpp::simtime_t percentile(double p) const
+    {
+        if (numValues == 0) return omnetpp::SIMTIME_ZERO;
+        int64_t rank = (int64_t)(p * numValues + 0.5);
+        if (rank < 1) rank = 1;
+        if (rank > numValues) rank = numValues;
+
+        int64_t seen = 0;
+        for (int b = 0; b < NUM_BLOCKS; b++) {
+            const std::vector<uint32_t>& block = blocks[b];
+            if (block.empty()) continue;
+            for (int i = 0; i < SUB_COUNT; i++) {
+                seen += block[i];
+                if (seen >= rank) return ticksToTime(std::min(upperEdge(b * SUB_COUNT + i), maxTicks));
+            }
+        }
+        return ticksToTime(maxTicks);
+    }
+
+    omnetpp::simtime_t mean() const { return numValues ? ticksToTime(sum / numValues) : omnetpp::SIMTIME_ZERO; }
+    omnetpp::simtime_t max() const { return ticksToTime(maxTicks); }
+
+    // name:count, name:mean, name:p50, name:p99, name:p99.9, name:max -- skipped if empty
+    void recordScalars(omnetpp::cComponent *component, const char *name) const
+    {
+        if (numValues == 0) return;
+        std::string prefix = std::string(name) + ":";
+        component->recordScalar((prefix + "count").c_str(), numValues);
+        component->recordScalar((prefix + "mean").c_str(), mean(), "s");
+        component->recordScalar((prefix + "p50").c_str(), percentile(0.5), "s");
+        component->recordScalar((prefix + "p99").c_str(), percentile(0.99), "s");
+        component->recordScalar((prefix + "p99.9").c_str(), percentile(0.999), "s");
+        component->recordScalar((prefix + "max").c_str(), max(), "s");
+    }
+
+  private:
+    static const int SUB_BITS = 6;
+    static const int MAX_BITS = 24;
+    static const int SUB_COUNT = 1 << SUB_BITS;
+    static const int NUM_BLOCKS = MAX_BITS - SUB_BITS + 2;
+    static const int NUM_BUCKETS = NUM_BLOCKS * SUB_COUNT;
+
+    // Values below SUB_COUNT map 1:1; above, exponent e keeps the top SUB_BITS+1 bits
+    static int indexOf(int64_t ticks)
+    {
+        if (ticks < SUB_COUNT) return (int)ticks;
+        int e = 63 - __builtin_clzll((uint64_t)ticks) - SUB_BITS;
+        int index = (e + 1) * SUB_COUNT + (int)((ticks >> e) - SUB_COUNT);
+        return index < NUM_BUCKETS ? index : NUM_BUCKETS - 1;
+    }
+
+    static int64_t upperEdge(int index)
+    {
+        if (index < SUB_COUNT) return index;
+        int e = index / SUB_COUNT - 1;
+        int64_t mantissa = SUB_COUNT + index % SUB_COUNT;
+        return ((mantissa + 1) << e) - 1;
+    }
+
+    static omnetpp::simtime_t ticksToTime(int64_t ticks) { return omnetpp::SimTime(ticks, omnetpp::SIMTIME_US); }
+
+    std::vector<std::vector<uint32_t>> blocks;  // per power of two, empty until used
+    int64_t numValues = 0;
+    int64_t sum = 0;
+    int64_t maxTicks = 0;
+};
+
+// One LatencyHistogram per peer id, created on the peer's first value, so per-pair
+// tails stay visible. The aggregate over all peers is only merged when recording.
+// Ids outside [0, numPeers) (beyond the configured fleet) count in the aggregate only.
+class PeerLatencyHistograms
+{
+  public:
+    void reset(int numPeers)
+    {
+        peers.clear();
+        peers.resize(numPeers > 0 ? numPeers : 0);
+        others.clear();
+    }
+
+    void record(int peerId, omnetpp::simtime_t latency)
+    {
+        if (peerId < 0 || peerId >= (int)peers.size()) {
+            others.record(latency);
+            return;
+        }
+        std::unique_ptr<LatencyHistogram>& h = peers[peerId];
+        if (!h) h.reset(new LatencyHistogram());
+        h->record(latency);
+    }
+
+    // name:peer<id>:<stat> for every peer with values, then name:<stat> over all of them
+    void recordScalars(omnetpp::cComponent *component, const char *name) const
+    {
+        LatencyHistogram all = others;
+        for (size_t i = 0; i < peers.size(); i++) {
+            if (!peers[i]) continue;
+            all.merge(*peers[i]);
+            peers[i]->recordScalars(component, (std::string(name) + ":peer" + std::to_string(i)).c_str());
+        }
+        all.recordScalars(component, name);
+    }
+
+  private:
+    std::vector<std::unique_ptr<LatencyHistogram>> peers;
+    LatencyHistogram others;
+};
@@ -0,0 +1,197 @@
+#include "common/NeighborTable.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "inet/mobility/contract/IMobility.h"
+#include "veins/base/modules/BaseMobility.h"
+#include "veins/modules/mobility/traci/TraCIMobility.h"
+
+Define_Module(NeighborTable);
+
+const simsignal_t NeighborTable::discoveryRatioSignal = registerSignal("discoveryRatio");
+
+NeighborTable::~NeighborTable()
+{
+    cancelAndDelete(sampleTimer);
+
+    cModule *root = getSimulation()->getSystemModule();
+    if (root->isSubscribed(inet::IMobility::mobilityStateChangedSignal, this)) root->unsubscribe(inet::IMobility::mobilityStateChangedSignal, this);
+    if (root->isSubscribed(veins::BaseMobility::mobilityStateChangedSignal, this)) root->unsubscribe(veins::BaseMobility::mobilityStateChangedSignal, this);
+}
+
+void NeighborTable::initialize()
+{
+    numVehicles = par("numVehicles");
+    range = par("range");
+    sampleInterval = par("sampleInterval");
+    if (range <= 0) throw cRuntimeError("range must be positive");
+
+    members.assign(numVehicles, Member());
+    discovered.assign(numVehicles, PeerSet(numVehicles));
+    positions.assign(numVehicles, inet::Coord());
+    scratch.reset(numVehicles);
+
+    // Any vehicle moving invalidates the grid, also several times within one instant (batched TraCI steps)
+    cModule *root = getSimulation()->getSystemModule();
+    root->subscribe(inet::IMobility::mobilityStateChangedSignal, this);
+    root->subscribe(veins::BaseMobility::mobilityStateChangedSignal, this);
+
+    sampleTimer = new cMessage("sampleDiscovery");
+    if (sampleInterval > SimTime(0)) scheduleAt(simTime() + sampleInterval, sampleTimer);
+}
+
+void NeighborTable::registerVehicle(int id, inet::IMobility *mobility)
+{
+    if (id < 0 || id >= numVehicles) return;  // beyond the configured fleet, like PeerSet
+    members[id] = Member();
+    members[id].inetMobility = mobility;
+    discovered[id].clear();
+    positionGeneration++;
+}
+
+void NeighborTable::registerVehicle(int id, veins::TraCIMobility *mobility)
+{
+    if (id < 0 || id >= numVehicles) return;
+    members[id] = Member();
+    members[id].traciMobility = mobility;
+    discovered[id].clear();
+    positionGeneration++;
+}
+
+void NeighborTable::unregisterVehicle(int id)
+{
+    if (id < 0 || id >= numVehicles) return;
+    members[id] = Member();
+    positionGeneration++;
+}
+
+void NeighborTable::reportDiscovered(int id, int peerId)
+{
+    if (id < 0 || id >= numVehicles) return;
+    discovered[id].insert(peerId);
+}
+
+inet::Coord NeighborTable::positionOf(int id) const
+{
+    const Member& m = members[id];
+    if (m.inetMobility) return m.inetMobility->getCurrentPosition();
+    veins::Coord pos = m.traciMobility->getPositionAt(simTime());
+    return inet::Coord(pos.x, pos.y, pos.z);
+}
+
+inet::Coord NeighborTable::velocityOf(int id) const
+{
+    const Member& m = members[id];
+    if (m.inetMobility) return m.inetMobility->getCurrentVelocity();
+    veins::Coord v = m.traciMobility->getHeading().toCoord() * m.traciMobility->getSpeed();
+    return inet::Coord(v.x, v.y, v.z);
+}
+
+void NeighborTable::receiveSignal(cComponent *source, simsignal_t signalID, cObject *obj, cObject *details)
+{
+    positionGeneration++;
+}
+
+void NeighborTable::rebuildGrid()
+{
+    // Positions only change at mobility updates, so one build serves every query until the next one
+    for (auto& cell : grid) cell.second.clear();
+
+    for (int id = 0; id < numVehicles; id++) {
+        if (!members[id].registered()) continue;
+        const inet::Coord& pos = positions[id] = positionOf(id);
+        grid[cellKey((int)std::floor(pos.x / range), (int)std::floor(pos.y / range))].push_back(id);
+    }
+
+    // Keep the buckets of occupied cells for reuse, drop the ones vehicles have left
+    for (auto it = grid.begin(); it != grid.end();) {
+        if (it->second.empty()) it = grid.erase(it);
+        else ++it;
+    }
+    gridGeneration = positionGeneration;
+}
+
+void NeighborTable::getNeighbors(int id, PeerSet& out)
+{
+    out.reset(numVehicles);
+    if (id < 0 || id >= numVehicles || !members[id].registered()) return;
+    if (gridGeneration != positionGeneration) rebuildGrid();
+
+    const inet::Coord& pos = positions[id];
+    int cx = (int)std::floor(pos.x / range);
+    int cy = (int)std::floor(pos.y / range);
+    double range2 = range * range;
+
+    // With cell size = range, everything in range is in the 3x3 block around the vehicle
+    for (int dx = -1; dx <= 1; dx++) {
+        for (int dy = -1; dy <= 1; dy++) {
+            auto it = grid.find(cellKey(cx + dx, cy + dy));
+            if (it == grid.end()) continue;
+            for (int peer : it->second) {
+                if (peer == id) continue;
+                if (pos.sqrdist(positions[peer]) <= range2) out.insert(peer);
+            }
+        }
+    }
+}
+
+bool NeighborTable::inRange(int id, int peerId)
+{
+    if (id < 0 || id >= numVehicles || !members[id].registered()) return false;
+    if (peerId < 0 || peerId >= numVehicles || !members[peerId].registered()) return false;
+    if (gridGeneration != positionGeneration) rebuildGrid();
+    return positions[id].sqrdist(positions[peerId]) <= range * range;
+}
+
+bool NeighborTable::predictLink(int id, int peerId, double& enterIn, double& lifetime)
+{
+    if (id < 0 || id >= numVehicles || !members[id].registered()) return false;
+    if (peerId < 0 || peerId >= numVehicles || !members[peerId].registered()) return false;
+    if (gridGeneration != positionGeneration) rebuildGrid();
+
+    // Relative motion p + v*t; in range while |p + v*t|^2 <= range^2
+    inet::Coord p = positions[peerId] - positions[id];
+    inet::Coord v = velocityOf(peerId) - velocityOf(id);
+    p.z = v.z = 0;
+    double a = v.x * v.x + v.y * v.y;
+    double b = 2 * (p.x * v.x + p.y * v.y);
+    double c = p.x * p.x + p.y * p.y - range * range;
+
+    if (a < 1e-9) {
+        // Same velocity: the distance does not change
+        if (c > 0) return false;
+        enterIn = 0;
+        lifetime = std::numeric_limits<double>::infinity();
+        return true;
+    }
+
+    double disc = b * b - 4 * a * c;
+    if (disc < 0) return false;  // passes by outside of range
+    double root = std::sqrt(disc);
+    double tEnter = (-b - root) / (2 * a);
+    double tLeave = (-b + root) / (2 * a);
+    if (tLeave <= 0) return false;  // already moving apart, out of range
+
+    enterIn = std::max(tEnter, 0.0);
+    lifetime = tLeave - enterIn;
+    return true;
+}
+
+void NeighborTable::handleMessage(cMessage *msg)
+{
+    if (msg != sampleTimer) throw cRuntimeError("Unexpected message '%s'", msg->getName());
+
+    long pairs = 0;
+    long found = 0;
+    for (int id = 0; id < numVehicles; id++) {
+        if (!members[id].registered()) continue;
+        getNeighbors(id, scratch);
+        pairs += scratch.count();
+        found += discovered[id].countCommon(scratch);
+    }
+    if (pairs > 0) emit(discoveryRatioSignal, (double)found / pairs);
+
+    scheduleAt(simTime() + sampleInterval, sampleTimer);
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <omnetpp.h>
+#include "inet/common/geometry/common/Coord.h"
+#include "common/PeerSet.h"
+
+using namespace omnetpp;
+
+namespace inet { class IMobility; }
+namespace veins { class TraCIMobility; }
+
+class NeighborTable : public cSimpleModule, public cListener
+{
+  public:
+    virtual ~NeighborTable();
+
+    void registerVehicle(int id, inet::IMobility *mobility);
+    void registerVehicle(int id, veins::TraCIMobility *mobility);  // WAVE nodes
+    void unregisterVehicle(int id);
+
+    // Registered vehicles within range of id right now, not including id
+    void getNeighbors(int id, PeerSet& out);
+
+    // True if both are registered and within range of each other right now
+    bool inRange(int id, int peerId);
+
+    // Straight-line extrapolation of both vehicles' current position and velocity:
+    // the link comes up in enterIn seconds (0 if in range now) and lasts lifetime
+    // seconds from then (infinite if the distance never grows beyond range).
+    // Returns false if the vehicles are not predicted to get into range at all.
+    bool predictLink(int id, int peerId, double& enterIn, double& lifetime);
+
+    // id has heard from / been acknowledged by peerId (for discoveryRatio)
+    void reportDiscovered(int id, int peerId);
+
+  protected:
+    virtual void initialize() override;
+    virtual void handleMessage(cMessage *msg) override;
+    virtual void receiveSignal(cComponent *source, simsignal_t signalID, cObject *obj, cObject *details) override;
+
+  private:
+    // ====== CONFIG ======
+    int numVehicles = 4;
+    double range = 300;
+    simtime_t sampleInterval;
+
+    // ====== STATE ======
+    struct Member
+    {
+        inet::IMobility *inetMobility = nullptr;
+        veins::TraCIMobility *traciMobility = nullptr;
+        bool registered() const { return inetMobility || traciMobility; }
+    };
+    std::vector<Member> members;                // by vehicle id
+    std::vector<PeerSet> discovered;            // by vehicle id
+
+    std::unordered_map<int64_t, std::vector<int>> grid;  // cell -> vehicle ids
+    std::vector<inet::Coord> positions;                   // by vehicle id, as of gridGeneration
+    uint64_t positionGeneration = 1;                      // bumped by every mobility update and (un)registration
+    uint64_t gridGeneration = 0;
+    PeerSet scratch;
+
+    cMessage *sampleTimer = nullptr;
+
+    static const simsignal_t discoveryRatioSignal;
+
+  private:
+    void rebuildGrid();
+    inet::Coord positionOf(int id) const;
+    inet::Coord velocityOf(int id) const;
+    int64_t cellKey(int cx, int cy) const { return (int64_t(cx) << 32) ^ uint32_t(cy); }
+};
@@ -0,0 +1,152 @@
+#include "common/PacketTracer.h"
+
+#include "inet/common/ModuleAccess.h"
+#include "inet/common/packet/Packet.h"
+#include "common/PacketTraceTag_m.h"
+#include "veins_inet/VeinsInetApplicationBase.h"
+
+Define_Module(PacketTracer);
+
+const simsignal_t PacketTracer::endToEndDelaySignal = registerSignal("endToEndDelay");
+const simsignal_t PacketTracer::senderRetriesSignal = registerSignal("senderRetries");
+
+PacketTracer::~PacketTracer()
+{
+    cModule *root = getSimulation()->getSystemModule();
+    for (simsignal_t signal : signals) {
+        if (root->isSubscribed(signal, this)) root->unsubscribe(signal, this);
+    }
+}
+
+void PacketTracer::initialize()
+{
+    int maxTraces = par("maxTraces");
+    if (maxTraces < 1) throw cRuntimeError("maxTraces must be positive");
+    traces.assign(maxTraces, Trace());
+
+    originSignal = registerSignal(par("originSignal"));
+    deliverySignal = registerSignal(par("deliverySignal"));
+    loopbackInterface = par("loopbackInterface").stdstringValue();
+
+    cStringTokenizer upTokenizer(par("upSignals"));
+    while (upTokenizer.hasMoreTokens()) upSignals.insert(registerSignal(upTokenizer.nextToken()));
+
+    cModule *root = getSimulation()->getSystemModule();
+    cStringTokenizer tokenizer(par("signals"));
+    while (tokenizer.hasMoreTokens()) {
+        simsignal_t signal = registerSignal(tokenizer.nextToken());
+        signals.push_back(signal);
+        root->subscribe(signal, this);
+    }
+}
+
+void PacketTracer::handleMessage(cMessage *msg)
+{
+    throw cRuntimeError("PacketTracer does not process messages");
+}
+
+const PacketTracer::Stage& PacketTracer::lookupStage(cComponent *source, simsignal_t signalID)
+{
+    uint64_t key = (uint64_t(source->getId()) << 32) | uint32_t(signalID);
+    auto it = stageOf.find(key);
+    if (it != stageOf.end()) return it->second;
+
+    // Name the hop by its path inside the host, so the same layer of every vehicle shares a stage
+    cModule *module = source->isModule() ? static_cast<cModule *>(source) : source->getParentModule();
+    cModule *host = inet::findContainingNode(module);
+    std::string path = source->getFullPath();
+    if (host) path = path.substr(host->getFullPath().size() + 1);
+    std::string name = path + ":" + getSignalName(signalID);
+
+    auto indexIt = stageIndex.find(name);
+    int index;
+    if (indexIt != stageIndex.end()) {
+        index = indexIt->second;
+    }
+    else {
+        index = stageNames.size();
+        stageNames.push_back(name);
+        stageIndex[name] = index;
+    }
+
+    bool loopback = !loopbackInterface.empty() && path.compare(0, loopbackInterface.size(), loopbackInterface) == 0
+            && (path.size() == loopbackInterface.size() || path[loopbackInterface.size()] == '[' || path[loopbackInterface.size()] == '.' || path[loopbackInterface.size()] == ':');
+
+    Stage& stage = stageOf[key];
+    stage.index = index;
+    stage.host = host ? host->getId() : -1;
+    stage.app = dynamic_cast<veins::VeinsInetApplicationBase *>(source) != nullptr;
+    stage.echo = loopback || upSignals.count(signalID) > 0;
+    return stage;
+}
+
+void PacketTracer::receiveSignal(cComponent *source, simsignal_t signalID, cObject *obj, cObject *details)
+{
+    auto packet = dynamic_cast<inet::Packet *>(obj);
+    if (!packet || packet->getDataLength() == inet::b(0)) return;
+
+    auto tags = packet->peekData()->getAllTags<PacketTraceTag>();
+    if (tags.empty()) return;
+    uint64_t traceId = tags.front().getTag()->getTraceId();
+
+    const Stage& stage = lookupStage(source, signalID);
+    Hop hop;
+    hop.host = stage.host;
+    hop.stage = stage.index;
+    hop.time = simTime();
+
+    Trace& trace = traces[traceId % traces.size()];
+    if (trace.traceId != traceId) {
+        // Only the sending app starts a trace; anything else belongs to one already dropped from the ring
+        if (signalID != originSignal || !stage.app) return;
+        trace.traceId = traceId;
+        trace.sent = hop.time;
+        trace.last = hop;
+        trace.senderStages = 0;
+        trace.retries = 0;
+        trace.receivers.clear();
+    }
+    else if (hop.host == trace.last.host) {
+        // Multicast loopback copies come back up on the sender: not part of its way to the air
+        if (stage.echo) return;
+
+        // A layer of the sender seeing the packet again is a retransmission
+        uint64_t bit = hop.stage < 64 ? uint64_t(1) << hop.stage : 0;
+        if (trace.senderStages & bit) trace.retries++;
+        recordHop(trace.last, hop);
+        trace.last = hop;
+    }
+    else {
+        Hop *previous = nullptr;
+        for (Hop& h : trace.receivers) {
+            if (h.host == hop.host) previous = &h;
+        }
+        if (!previous) {
+            // First hop on this receiver follows the sender's last one: the air
+            trace.receivers.push_back(trace.last);
+            previous = &trace.receivers.back();
+        }
+        recordHop(*previous, hop);
+        *previous = hop;
+
+        if (signalID == deliverySignal && stage.app) {
+            emit(endToEndDelaySignal, hop.time - trace.sent);
+            emit(senderRetriesSignal, trace.retries);
+        }
+    }
+
+    if (hop.host == trace.last.host && hop.stage < 64) trace.senderStages |= uint64_t(1) << hop.stage;
+}
+
+void PacketTracer::recordHop(const Hop& from, const Hop& to)
+{
+    hopHistograms[std::make_pair(from.stage, to.stage)].record(to.time - from.time);
+}
+
+void PacketTracer::finish()
+{
+    for (auto& kv : hopHistograms) {
+        std::string name = stageNames[kv.first.first] + " -> " + stageNames[kv.first.second];
+        kv.second.recordScalars(this, name.c_str());
+    }
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <omnetpp.h>
+#include "common/LatencyHistogram.h"
+
+using namespace omnetpp;
+
+class PacketTracer : public cSimpleModule, public cListener
+{
+  public:
+    virtual ~PacketTracer();
+
+  protected:
+    virtual void initialize() override;
+    virtual void handleMessage(cMessage *msg) override;
+    virtual void finish() override;
+    virtual void receiveSignal(cComponent *source, simsignal_t signalID, cObject *obj, cObject *details) override;
+
+  private:
+    // ====== CONFIG ======
+    std::vector<simsignal_t> signals;
+    simsignal_t originSignal = -1;
+    simsignal_t deliverySignal = -1;
+    std::set<simsignal_t> upSignals;
+    std::string loopbackInterface;
+
+    // ====== STATE ======
+    struct Hop
+    {
+        int host = -1;          // module id of the host
+        int stage = -1;
+        simtime_t time;
+    };
+    struct Trace
+    {
+        uint64_t traceId = 0;   // 0: slot unused
+        simtime_t sent;
+        Hop last;               // last hop on the sending host
+        uint64_t senderStages = 0;  // bit per stage index < 64 seen on the sender
+        int retries = 0;
+        std::vector<Hop> receivers;  // last hop per receiving host
+    };
+    std::vector<Trace> traces;  // ring, by traceId % size
+
+    struct Stage
+    {
+        int index;
+        int host;
+        bool app;   // emitted by the traced app itself
+        bool echo;  // up the stack or through the loopback interface: never part of the sender's way down
+    };
+    std::unordered_map<uint64_t, Stage> stageOf;  // (component id, signal) -> stage
+    std::vector<std::string> stageNames;
+    std::unordered_map<std::string, int> stageIndex;
+    std::map<std::pair<int, int>, LatencyHistogram> hopHistograms;  // (from stage, to stage)
+
+    static const simsignal_t endToEndDelaySignal;
+    static const simsignal_t senderRetriesSignal;
+
+  private:
+    const Stage& lookupStage(cComponent *source, simsignal_t signalID);
+    void recordHop(const Hop& from, const Hop& to);
+};
@@ -0,0 +1,37 @@
+#include "common/PeerDirectory.h"
+
+#include "inet/networklayer/common/L3AddressResolver.h"
+
+Define_Module(PeerDirectory);
+
+void PeerDirectory::initialize()
+{
+    addresses.clear();
+    numRegistered = 0;
+}
+
+void PeerDirectory::registerPeer(int id, cModule *host)
+{
+    if (id < 0) throw cRuntimeError("Invalid vehicle id %d", id);
+    if (id >= (int)addresses.size()) addresses.resize(id + 1);
+
+    addresses[id] = inet::L3AddressResolver().addressOf(host, inet::L3AddressResolver::ADDR_IPv4);
+    numRegistered++;
+}
+
+void PeerDirectory::unregisterPeer(int id)
+{
+    if (id < 0 || id >= (int)addresses.size()) return;
+    addresses[id] = inet::L3Address();
+}
+
+const inet::L3Address& PeerDirectory::getAddress(int id) const
+{
+    if (id < 0 || id >= (int)addresses.size()) return unknown;
+    return addresses[id];
+}
+
+void PeerDirectory::finish()
+{
+    recordScalar("registeredPeers", numRegistered);
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <vector>
+#include <omnetpp.h>
+#include "inet/networklayer/common/L3Address.h"
+
+using namespace omnetpp;
+
+class PeerDirectory : public cSimpleModule
+{
+  public:
+    // Resolves the address of host once; later lookups are a vector access
+    void registerPeer(int id, cModule *host);
+    void unregisterPeer(int id);
+
+    // Unspecified if id has not registered (not started yet, or already gone)
+    const inet::L3Address& getAddress(int id) const;
+
+  protected:
+    virtual void initialize() override;
+    virtual void finish() override;
+
+  private:
+    // ====== STATE ======
+    std::vector<inet::L3Address> addresses;  // by vehicle id, grows with the fleet
+    inet::L3Address unknown;
+    int numRegistered = 0;
+};
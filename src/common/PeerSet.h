@@ -0,0 +1,152 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Dense set of vehicle ids in [0, capacity), stored as a bitset.
+// contains/insert/erase are O(1) and the member count is kept up to date,
+// so completion checks do not scan the fleet. Ids outside the range are
+// ignored (vehicles beyond the configured fleet size).
+class PeerSet
+{
+  public:
+    PeerSet() {}
+    explicit PeerSet(int capacity) { reset(capacity); }
+
+    void reset(int capacity)
+    {
+        numPeers = capacity > 0 ? capacity : 0;
+        words.assign((numPeers + 63) / 64, 0);
+        numSet = 0;
+    }
+
+    void clear()
+    {
+        std::fill(words.begin(), words.end(), 0);
+        numSet = 0;
+    }
+
+    int capacity() const { return numPeers; }
+    int count() const { return numSet; }
+    int missing() const { return numPeers - numSet; }
+    bool full() const { return numSet >= numPeers; }
+
+    bool contains(int id) const
+    {
+        if (id < 0 || id >= numPeers) return false;
+        return (words[id >> 6] >> (id & 63)) & 1;
+    }
+
+    // Returns true if the id was not in the set before
+    bool insert(int id)
+    {
+        if (id < 0 || id >= numPeers) return false;
+        uint64_t bit = uint64_t(1) << (id & 63);
+        uint64_t& w = words[id >> 6];
+        if (w & bit) return false;
+        w |= bit;
+        numSet++;
+        return true;
+    }
+
+    // Returns true if the id was in the set before
+    bool erase(int id)
+    {
+        if (id < 0 || id >= numPeers) return false;
+        uint64_t bit = uint64_t(1) << (id & 63);
+        uint64_t& w = words[id >> 6];
+        if (!(w & bit)) return false;
+        w &= ~bit;
+        numSet--;
+        return true;
+    }
+
+    // Number of members that are also in other (sets of any capacity)
+    int countCommon(const PeerSet& other) const
+    {
+        int n = 0;
+        size_t len = std::min(words.size(), other.words.size());
+        for (size_t i = 0; i < len; i++) {
+            n += __builtin_popcountll(words[i] & other.words[i]);
+        }
+        return n;
+    }
+
+    // True if every member of other is also a member of this set
+    bool containsAll(const PeerSet& other) const
+    {
+        return countCommon(other) == other.count();
+    }
+
+    // Calls f(id) for every member, in increasing id order
+    template <typename F>
+    void forEach(F f) const
+    {
+        for (size_t i = 0; i < words.size(); i++) {
+            uint64_t w = words[i];
+            while (w) {
+                f(int(i * 64 + __builtin_ctzll(w)));
+                w &= w - 1;
+            }
+        }
+    }
+
+    // Calls f(id) for every id in [0, capacity) that is not a member
+    template <typename F>
+    void forEachMissing(F f) const
+    {
+        for (size_t i = 0; i < words.size(); i++) {
+            uint64_t w = ~words[i];
+            if (i == words.size() - 1 && (numPeers & 63)) w &= (uint64_t(1) << (numPeers & 63)) - 1;
+            while (w) {
+                f(int(i * 64 + __builtin_ctzll(w)));
+                w &= w - 1;
+            }
+        }
+    }
+
+    // Number of bytes needed to encode the set as a bitmap up to its highest member
+    int byteCount() const
+    {
+        for (int i = int(words.size()) - 1; i >= 0; i--) {
+            if (words[i]) return i * 8 + (63 - __builtin_clzll(words[i])) / 8 + 1;
+        }
+        return 0;
+    }
+
+    // Byte i of the bitmap encoding (bit b of byte i is id i*8+b)
+    uint8_t byteAt(int i) const
+    {
+        return uint8_t(words[i >> 3] >> ((i & 7) * 8));
+    }
+
+    // "{0,2,3}" -- for logging only
+    std::string toString() const
+    {
+        std::string out = "{";
+        forEach([&out](int id) {
+            if (out.size() > 1) out += ",";
+            out += std::to_string(id);
+        });
+        out += "}";
+        return out;
+    }
+
+    // Same as toString() but for the ids that are not members
+    std::string missingToString() const
+    {
+        std::string out = "{";
+        forEachMissing([&out](int id) {
+            if (out.size() > 1) out += ",";
+            out += std::to_string(id);
+        });
+        out += "}";
+        return out;
+    }
+
+  private:
+    std::vector<uint64_t> words;
+    int numPeers = 0;
+    int numSet = 0;
+};
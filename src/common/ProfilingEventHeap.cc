@@ -0,0 +1,52 @@
+#include "common/ProfilingEventHeap.h"
+
+Register_Class(ProfilingEventHeap);
+
+int ProfilingEventHeap::indexOf(std::unordered_map<const void *, int>& index, std::vector<Entry>& entries, const void *key, const char *name)
+{
+    auto it = index.find(key);
+    if (it != index.end()) return it->second;
+    int i = entries.size();
+    entries.emplace_back();
+    entries.back().name = name;
+    index[key] = i;
+    return i;
+}
+
+cEvent *ProfilingEventHeap::removeFirst()
+{
+    cEvent *event = cEventHeap::removeFirst();
+    flush();
+    if (!event) return event;
+
+    // Non-message events (e.g. channel transmission ends) are grouped under their class only
+    const void *typeKey = nullptr;
+    const char *typeName = "(none)";
+    if (event->isMessage()) {
+        cModule *module = getSimulation()->getModule(static_cast<cMessage *>(event)->getArrivalModuleId());
+        if (module) {
+            cComponentType *type = module->getComponentType();
+            typeKey = type;
+            typeName = type->getName();
+        }
+    }
+    lastModuleType = indexOf(moduleTypeIndex, moduleTypes, typeKey, typeName);
+    lastMessageClass = indexOf(messageClassIndex, messageClasses, &typeid(*event), event->getClassName());
+    return event;
+}
+
+void ProfilingEventHeap::flush()
+{
+    Clock::time_point now = Clock::now();
+    if (lastModuleType >= 0) {
+        int64_t nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(now - lastStart).count();
+        Entry& type = moduleTypes[lastModuleType];
+        type.events++;
+        type.nanos += nanos;
+        Entry& cls = messageClasses[lastMessageClass];
+        cls.events++;
+        cls.nanos += nanos;
+        lastModuleType = lastMessageClass = -1;
+    }
+    lastStart = now;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <typeinfo>
+#include <unordered_map>
+#include <vector>
+#include <omnetpp.h>
+
+using namespace omnetpp;
+
+// Future event set that measures where wall time goes. Select it per run with
+//   futureeventset-class = "ProfilingEventHeap"
+// Every removeFirst() is the start of the next event, so the wall time since the
+// previous removeFirst() is charged to the previous event: its target module
+// type and its message class. Without that option the plain cEventHeap is used
+// and nothing is measured.
+class ProfilingEventHeap : public cEventHeap
+{
+  public:
+    struct Entry
+    {
+        const char *name;
+        int64_t events = 0;
+        int64_t nanos = 0;
+    };
+
+    explicit ProfilingEventHeap(const char *name = nullptr) : cEventHeap(name) {}
+
+    virtual cEvent *removeFirst() override;
+
+    // Charges the event in progress, so the totals are complete up to now
+    void flush();
+
+    const std::vector<Entry>& getModuleTypes() const { return moduleTypes; }
+    const std::vector<Entry>& getMessageClasses() const { return messageClasses; }
+
+  private:
+    typedef std::chrono::steady_clock Clock;
+
+    int indexOf(std::unordered_map<const void *, int>& index, std::vector<Entry>& entries, const void *key, const char *name);
+
+    std::vector<Entry> moduleTypes;
+    std::vector<Entry> messageClasses;
+    std::unordered_map<const void *, int> moduleTypeIndex;    // by cComponentType
+    std::unordered_map<const void *, int> messageClassIndex;  // by std::type_info
+
+    Clock::time_point lastStart;
+    int lastModuleType = -1;
+    int lastMessageClass = -1;
+};
@@ -0,0 +1,166 @@
+#include "common/ProtocolLog.h"
+
+#include <algorithm>
+#include <string>
+
+using namespace omnetpp;
+
+Register_PerRunConfigOption(CFGID_BENCHMARK_LOG_LEVEL, "benchmark-log-level", CFG_INT, "1", "Verbosity of the handshake apps' protocol log: 0 off, 1 completion/timeout summaries, 2 per-packet events, 3 debug");
+Register_PerRunConfigOption(CFGID_BENCHMARK_LOG_FILE, "benchmark-log-file", CFG_FILENAME, "", "File the protocol log is written to. Empty means standard output");
+Register_PerRunConfigOption(CFGID_BENCHMARK_LOG_BUFFER, "benchmark-log-buffer", CFG_INT, "65536", "Number of protocol log records buffered before they are handed to the writer thread");
+
+// Upper bound of one formatted line
+static const size_t MAX_LINE = 160;
+
+ProtocolLog::~ProtocolLog()
+{
+    flush();
+}
+
+void ProtocolLog::configure()
+{
+    cConfiguration *cfg = getEnvir()->getConfig();
+    verbosity = cfg->getAsInt(CFGID_BENCHMARK_LOG_LEVEL);
+    active = true;
+
+    // Flush at the end of every run; registered once per process
+    if (!listening) {
+        getEnvir()->addLifecycleListener(this);
+        listening = true;
+    }
+
+    if (verbosity <= PLOG_OFF) return;
+
+    size_t capacity = std::max<long>(cfg->getAsInt(CFGID_BENCHMARK_LOG_BUFFER), 16);
+    buffer.resize(capacity);
+    spare.resize(capacity);
+    fill = 0;
+    spareFill = 0;
+    sparePending = false;
+    stopping = false;
+
+    std::string fileName = cfg->getAsFilename(CFGID_BENCHMARK_LOG_FILE);
+    // Later runs of the same process append instead of truncating earlier output
+    out = fileName.empty() ? stdout : fopen(fileName.c_str(), fileName == openedFile ? "a" : "w");
+    if (!out) throw cRuntimeError("Cannot open protocol log file '%s'", fileName.c_str());
+    openedFile = fileName;
+
+    writer = std::thread(&ProtocolLog::writerLoop, this);
+}
+
+void ProtocolLog::lifecycleEvent(SimulationLifecycleEventType eventType, cObject *details)
+{
+    if (eventType == LF_ON_RUN_END || eventType == LF_PRE_NETWORK_DELETE) flush();
+}
+
+void ProtocolLog::handOff()
+{
+    // Wait until the writer is done with the previous buffer, then swap
+    std::unique_lock<std::mutex> lock(mutex);
+    cond.wait(lock, [this]() { return !sparePending; });
+    buffer.swap(spare);
+    spareFill = fill;
+    sparePending = true;
+    fill = 0;
+    cond.notify_all();
+}
+
+void ProtocolLog::flush()
+{
+    if (writer.joinable()) {
+        if (fill > 0) handOff();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        cond.notify_all();
+        writer.join();
+    }
+
+    if (out == stdout) fflush(out);
+    else if (out) fclose(out);
+    out = nullptr;
+
+    active = false;
+    verbosity = PLOG_OFF;
+}
+
+void ProtocolLog::writerLoop()
+{
+    std::vector<char> text;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        cond.wait(lock, [this]() { return sparePending || stopping; });
+        if (!sparePending) break;
+
+        // The simulation thread does not touch spare while sparePending is set
+        lock.unlock();
+        text.resize(spareFill * MAX_LINE);
+        size_t len = 0;
+        for (size_t i = 0; i < spareFill; i++) {
+            len += format(text.data() + len, text.size() - len, spare[i]);
+        }
+        fwrite(text.data(), 1, len, out);
+        lock.lock();
+
+        sparePending = false;
+        cond.notify_all();
+    }
+}
+
+int ProtocolLog::format(char *buf, size_t size, const ProtocolLogRecord& r)
+{
+    long long a = r.a, b = r.b;
+    int n = 0;
+
+    switch (r.event) {
+        case ProtocolEvent::HELLO_TX:  // peer: TCP target or -1, a: sequence number, b: acked/sent count
+            if (r.peer >= 0) n = snprintf(buf, size, "%.12g v%d HELLO_TX #%lld to=%d sent=%lld\n", r.t, r.vehicle, a, r.peer, b);
+            else n = snprintf(buf, size, "%.12g v%d HELLO_TX #%lld acked=%lld\n", r.t, r.vehicle, a, b);
+            break;
+        case ProtocolEvent::HELLO_RX:  // peer: sender
+            n = snprintf(buf, size, "%.12g v%d HELLO_RX from=%d\n", r.t, r.vehicle, r.peer);
+            break;
+        case ProtocolEvent::ACK_TX:  // peer: target, or -1 for an aggregated ACK (a: number of targets)
+            if (r.peer >= 0) n = snprintf(buf, size, "%.12g v%d ACK_TX to=%d\n", r.t, r.vehicle, r.peer);
+            else n = snprintf(buf, size, "%.12g v%d ACK_TX targets=%lld\n", r.t, r.vehicle, a);
+            break;
+        case ProtocolEvent::ACK_RX:  // peer: sender, b: acked count
+            n = snprintf(buf, size, "%.12g v%d ACK_RX from=%d acked=%lld\n", r.t, r.vehicle, r.peer, b);
+            break;
+        case ProtocolEvent::COMPLETED:  // a: HELLO attempts, b: frames sent, x: duration
+            n = snprintf(buf, size, "%.12g v%d COMPLETED attempts=%lld frames=%lld duration=%.12gs\n", r.t, r.vehicle, a, b, r.x);
+            break;
+        case ProtocolEvent::TIMEOUT:  // a: HELLO attempts, b: acked count
+            n = snprintf(buf, size, "%.12g v%d TIMEOUT attempts=%lld acked=%lld\n", r.t, r.vehicle, a, b);
+            break;
+        case ProtocolEvent::TCP_COMPLETED:  // a: HELLO attempts, b: connection attempts, x: duration
+            n = snprintf(buf, size, "%.12g v%d COMPLETED attempts=%lld connects=%lld duration=%.12gs\n", r.t, r.vehicle, a, b, r.x);
+            break;
+        case ProtocolEvent::TCP_LISTEN:  // a: port
+            n = snprintf(buf, size, "%.12g v%d TCP_LISTEN port=%lld\n", r.t, r.vehicle, a);
+            break;
+        case ProtocolEvent::TCP_CONNECT:  // peer: target
+            n = snprintf(buf, size, "%.12g v%d TCP_CONNECT to=%d\n", r.t, r.vehicle, r.peer);
+            break;
+        case ProtocolEvent::TCP_ACCEPT:  // a: connection id
+            n = snprintf(buf, size, "%.12g v%d TCP_ACCEPT conn=%lld\n", r.t, r.vehicle, a);
+            break;
+        case ProtocolEvent::TCP_ESTABLISHED:  // peer: remote vehicle
+            n = snprintf(buf, size, "%.12g v%d TCP_ESTABLISHED peer=%d\n", r.t, r.vehicle, r.peer);
+            break;
+        case ProtocolEvent::TCP_CLOSED:  // peer: remote vehicle or -1
+            n = snprintf(buf, size, "%.12g v%d TCP_CLOSED peer=%d\n", r.t, r.vehicle, r.peer);
+            break;
+        case ProtocolEvent::TCP_FAILURE:  // peer: remote vehicle or -1, a: TCP status code
+            n = snprintf(buf, size, "%.12g v%d TCP_FAILURE peer=%d code=%lld\n", r.t, r.vehicle, r.peer, a);
+            break;
+        case ProtocolEvent::STOPPED_AT_INTERSECTION:  // x, y: position
+            n = snprintf(buf, size, "%.12g v%d STOPPED x=%.2f y=%.2f\n", r.t, r.vehicle, r.x, r.y);
+            break;
+    }
+
+    if (n < 0) return 0;
+    return (size_t)n < size ? n : (int)size - 1;
+}
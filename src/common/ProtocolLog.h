@@ -0,0 +1,133 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <omnetpp.h>
+
+// ====== PROTOCOL LOG ======
+// Low-overhead replacement for the per-packet std::cout lines of the handshake apps.
+//
+// PROTOCOL_LOG(level, event, vehicle, peer, a, b, x, y) stores a fixed-size binary
+// record in a per-run buffer; nothing is formatted on the simulation thread.
+// Full buffers are handed to a writer thread that formats them as one compact
+// text line per record and writes them in a single fwrite.
+//
+// Runtime verbosity (omnetpp.ini, per run):
+//   benchmark-log-level  = 0 off, 1 summary (COMPLETED/TIMEOUT), 2 per-packet events, 3 debug
+//   benchmark-log-file   = output file, empty for stdout
+//   benchmark-log-buffer = records per buffer
+//
+// Build with -DBENCHMARK_NO_PROTOCOL_LOG to compile every PROTOCOL_LOG call away.
+
+enum ProtocolLogLevel
+{
+    PLOG_OFF = 0,
+    PLOG_SUMMARY = 1,
+    PLOG_EVENTS = 2,
+    PLOG_DEBUG = 3
+};
+
+// Meaning of the peer/a/b/x fields per event is documented in ProtocolLog.cc (format())
+enum class ProtocolEvent : uint16_t
+{
+    HELLO_TX,
+    HELLO_RX,
+    ACK_TX,
+    ACK_RX,
+    COMPLETED,
+    TIMEOUT,
+    TCP_COMPLETED,
+    TCP_LISTEN,
+    TCP_CONNECT,
+    TCP_ACCEPT,
+    TCP_ESTABLISHED,
+    TCP_CLOSED,
+    TCP_FAILURE,
+    STOPPED_AT_INTERSECTION
+};
+
+struct ProtocolLogRecord
+{
+    double t;
+    int32_t vehicle;
+    ProtocolEvent event;
+    int32_t peer;
+    int64_t a;
+    int64_t b;
+    double x;
+    double y;
+};
+
+class ProtocolLog : public omnetpp::cISimulationLifecycleListener
+{
+  public:
+    static ProtocolLog& getInstance()
+    {
+        static ProtocolLog instance;
+        if (!instance.active) instance.configure();
+        return instance;
+    }
+
+    bool isEnabled(int level) const { return level <= verbosity; }
+
+    void record(ProtocolEvent event, int vehicle, int peer = -1, int64_t a = 0, int64_t b = 0, double x = 0, double y = 0)
+    {
+        ProtocolLogRecord& r = buffer[fill];
+        r.t = omnetpp::simTime().dbl();
+        r.vehicle = vehicle;
+        r.event = event;
+        r.peer = peer;
+        r.a = a;
+        r.b = b;
+        r.x = x;
+        r.y = y;
+        if (++fill == buffer.size()) handOff();
+    }
+
+    // Writes out everything recorded so far and stops the writer thread
+    void flush();
+
+  protected:
+    virtual void lifecycleEvent(omnetpp::SimulationLifecycleEventType eventType, omnetpp::cObject *details) override;
+
+  private:
+    ProtocolLog() {}
+    ~ProtocolLog();
+
+    void configure();
+    void handOff();
+    void writerLoop();
+    static int format(char *out, size_t size, const ProtocolLogRecord& r);
+
+    bool active = false;
+    bool listening = false;
+    int verbosity = PLOG_OFF;
+
+    std::vector<ProtocolLogRecord> buffer;   // filled by the simulation thread
+    size_t fill = 0;
+
+    std::vector<ProtocolLogRecord> spare;    // being written by the writer thread
+    size_t spareFill = 0;
+    bool sparePending = false;
+    bool stopping = false;
+
+    FILE *out = nullptr;
+    std::string openedFile;
+    std::thread writer;
+    std::mutex mutex;
+    std::condition_variable cond;
+};
+
+#ifdef BENCHMARK_NO_PROTOCOL_LOG
+#define PROTOCOL_LOG(level, ...) ((void)0)
+#else
+#define PROTOCOL_LOG(level, ...) \
+    do { \
+        ProtocolLog& plog_ = ProtocolLog::getInstance(); \
+        if (plog_.isEnabled(level)) plog_.record(__VA_ARGS__); \
+    } while (0)
+#endif
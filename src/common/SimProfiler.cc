@@ -0,0 +1,107 @@
+#include "common/SimProfiler.h"
+
+#include <algorithm>
+#include <string>
+
+Define_Module(SimProfiler);
+
+const simsignal_t SimProfiler::wallPerSimSecondSignal = registerSignal("wallPerSimSecond");
+const simsignal_t SimProfiler::eventRateSignal = registerSignal("eventRate");
+
+SimProfiler::~SimProfiler()
+{
+    cancelAndDelete(sampleTimer);
+}
+
+double SimProfiler::secondsSince(Clock::time_point since, Clock::time_point now)
+{
+    return std::chrono::duration<double>(now - since).count();
+}
+
+void SimProfiler::initialize()
+{
+    sampleInterval = par("sampleInterval");
+    topEntries = par("topEntries");
+
+    startWall = lastWall = Clock::now();
+    startSim = lastSim = simTime();
+    startEvent = lastEvent = getSimulation()->getEventNumber();
+
+    sampleTimer = new cMessage("profilerSample");
+    if (sampleInterval > SimTime(0)) scheduleAt(simTime() + sampleInterval, sampleTimer);
+}
+
+void SimProfiler::handleMessage(cMessage *msg)
+{
+    if (msg != sampleTimer) throw cRuntimeError("SimProfiler does not process messages");
+
+    Clock::time_point now = Clock::now();
+    double wall = secondsSince(lastWall, now);
+    eventnumber_t event = getSimulation()->getEventNumber();
+    emit(wallPerSimSecondSignal, wall / (simTime() - lastSim).dbl());
+    if (wall > 0) emit(eventRateSignal, (event - lastEvent) / wall);
+
+    lastWall = now;
+    lastSim = simTime();
+    lastEvent = event;
+    scheduleAt(simTime() + sampleInterval, sampleTimer);
+}
+
+void SimProfiler::writeTable(FILE *out, const char *title, std::vector<ProfilingEventHeap::Entry> entries, int64_t totalNanos)
+{
+    std::sort(entries.begin(), entries.end(), [](const ProfilingEventHeap::Entry& a, const ProfilingEventHeap::Entry& b) { return a.nanos > b.nanos; });
+
+    fprintf(out, "  %-40s %12s %7s %10s %9s\n", title, "events", "wall%", "wall(s)", "ns/event");
+    int rows = 0;
+    ProfilingEventHeap::Entry rest;
+    rest.name = "(other)";
+    for (const auto& e : entries) {
+        if (rows++ < topEntries) {
+            fprintf(out, "  %-40s %12lld %6.1f%% %10.3f %9lld\n", e.name, (long long)e.events,
+                    totalNanos ? 100.0 * e.nanos / totalNanos : 0.0, e.nanos * 1e-9, (long long)(e.events ? e.nanos / e.events : 0));
+        }
+        else {
+            rest.events += e.events;
+            rest.nanos += e.nanos;
+        }
+    }
+    if (rest.events > 0) {
+        fprintf(out, "  %-40s %12lld %6.1f%% %10.3f %9lld\n", rest.name, (long long)rest.events,
+                totalNanos ? 100.0 * rest.nanos / totalNanos : 0.0, rest.nanos * 1e-9, (long long)(rest.nanos / rest.events));
+    }
+}
+
+void SimProfiler::finish()
+{
+    double wall = secondsSince(startWall, Clock::now());
+    double sim = (simTime() - startSim).dbl();
+    eventnumber_t events = getSimulation()->getEventNumber() - startEvent;
+
+    recordScalar("events", events);
+    recordScalar("eventsPerSecond", wall > 0 ? events / wall : 0);
+    recordScalar("wallTime", wall, "s");
+    recordScalar("wallPerSimSecond", sim > 0 ? wall / sim : 0);
+
+    std::string fileName = par("reportFile").stdstringValue();
+    FILE *out = fileName.empty() ? stdout : fopen(fileName.c_str(), "a");
+    if (!out) throw cRuntimeError("Cannot open profiler report file '%s'", fileName.c_str());
+
+    const char *runId = getEnvir()->getConfigEx()->getVariable(CFGVAR_RUNID);
+    fprintf(out, "profile %s: %lld events, %.3fs wall, %.3fs simulated, %.0f events/s, %.4f wall s per sim s\n",
+            runId, (long long)events, wall, sim, wall > 0 ? events / wall : 0.0, sim > 0 ? wall / sim : 0.0);
+
+    auto heap = dynamic_cast<ProfilingEventHeap *>(getSimulation()->getFES());
+    if (heap) {
+        heap->flush();
+        int64_t totalNanos = 0;
+        for (const auto& e : heap->getModuleTypes()) totalNanos += e.nanos;
+        writeTable(out, "module type", heap->getModuleTypes(), totalNanos);
+        writeTable(out, "message class", heap->getMessageClasses(), totalNanos);
+    }
+    else {
+        fprintf(out, "  (set futureeventset-class = \"ProfilingEventHeap\" for the per-module breakdown)\n");
+    }
+
+    if (out == stdout) fflush(out);
+    else fclose(out);
+}
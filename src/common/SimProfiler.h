@@ -0,0 +1,42 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include <omnetpp.h>
+#include "common/ProfilingEventHeap.h"
+
+using namespace omnetpp;
+
+class SimProfiler : public cSimpleModule
+{
+  public:
+    virtual ~SimProfiler();
+
+  protected:
+    virtual void initialize() override;
+    virtual void handleMessage(cMessage *msg) override;
+    virtual void finish() override;
+
+  private:
+    typedef std::chrono::steady_clock Clock;
+
+    // ====== CONFIG ======
+    simtime_t sampleInterval;
+    int topEntries = 12;
+
+    // ====== STATE ======
+    cMessage *sampleTimer = nullptr;
+    Clock::time_point startWall;
+    simtime_t startSim;
+    eventnumber_t startEvent = 0;
+    Clock::time_point lastWall;
+    simtime_t lastSim;
+    eventnumber_t lastEvent = 0;
+
+    static const simsignal_t wallPerSimSecondSignal;
+    static const simsignal_t eventRateSignal;
+
+    static double secondsSince(Clock::time_point since, Clock::time_point now);
+    void writeTable(FILE *out, const char *title, std::vector<ProfilingEventHeap::Entry> entries, int64_t totalNanos);
+};
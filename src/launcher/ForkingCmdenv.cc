@@ -0,0 +1,120 @@
+#include "launcher/ForkingCmdenv.h"
+
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "envir/appreg.h"
+
+using namespace omnetpp;
+
+Register_OmnetApp("ForkCmdenv", ForkingCmdenv, 5, "Cmdenv that forks one process per run from a preloaded image");
+
+Register_GlobalConfigOption(CFGID_FORK_WORKERS, "fork-workers", CFG_INT, "0", "ForkCmdenv: number of runs executed in parallel. 0 means one per online CPU");
+
+std::string ForkingCmdenv::runFilterArg;
+
+void ForkingCmdenv::doRun()
+{
+    if (args->optionGiven('c')) opt->configName = args->optionValue('c');
+    if (opt->configName.empty()) opt->configName = "General";
+    if (!runFilterArg.empty()) opt->runFilter = runFilterArg;
+
+    std::vector<int> runNumbers;
+    try {
+        runNumbers = resolveRunFilter(opt->configName.c_str(), opt->runFilter.c_str());
+    }
+    catch (std::exception& e) {
+        displayException(e);
+        exitCode = 1;
+        return;
+    }
+
+    int workers = cfg->getAsInt(CFGID_FORK_WORKERS);
+    if (workers <= 0) workers = sysconf(_SC_NPROCESSORS_ONLN);
+
+    // Nothing to share with a single run
+    if (runNumbers.size() <= 1 || workers <= 1) {
+        Cmdenv::doRun();
+        return;
+    }
+
+    try {
+        checkLogFiles(runNumbers);
+    }
+    catch (std::exception& e) {
+        displayException(e);
+        exitCode = 1;
+        return;
+    }
+
+    int failed = forkRuns(runNumbers, workers);
+    if (isChild) return;
+    fprintf(stderr, "ForkCmdenv: %d runs, %d failed\n", (int)runNumbers.size(), failed);
+    if (failed > 0) exitCode = 1;
+}
+
+void ForkingCmdenv::checkLogFiles(const std::vector<int>& runNumbers)
+{
+    // Every child opens its protocol log with "w": a name shared by all runs would be
+    // truncated and interleaved by the concurrent runs
+    std::string firstName;
+    for (size_t i = 0; i < runNumbers.size() && i < 2; i++) {
+        cfg->activateConfig(opt->configName.c_str(), runNumbers[i]);
+        const char *level = cfg->getConfigValue("benchmark-log-level");
+        if (level && !strcmp(level, "0")) return;
+        const char *fileName = cfg->getConfigValue("benchmark-log-file");
+        std::string name = fileName ? fileName : "";
+        if (name.empty() || name == "\"\"") return;  // standard output
+        if (i == 0) firstName = name;
+        else if (name == firstName)
+            throw cRuntimeError("ForkCmdenv: benchmark-log-file '%s' is the same for every run, include ${runnumber} in it", name.c_str());
+    }
+}
+
+int ForkingCmdenv::forkRuns(const std::vector<int>& runNumbers, int workers)
+{
+    std::map<pid_t, int> running;  // pid -> run number
+    int failed = 0;
+    size_t next = 0;
+
+    while (next < runNumbers.size() || !running.empty()) {
+        while (next < runNumbers.size() && (int)running.size() < workers) {
+            int runNumber = runNumbers[next++];
+
+            // Anything still buffered would be written again by the child
+            fflush(stdout);
+            fflush(stderr);
+
+            pid_t pid = fork();
+            if (pid < 0) {
+                perror("ForkCmdenv: fork");
+                failed++;
+                continue;
+            }
+            if (pid == 0) {
+                // Child: a plain Cmdenv run of just this run number, then the normal shutdown path
+                isChild = true;
+                opt->runFilter = std::to_string(runNumber);
+                Cmdenv::doRun();
+                return 0;
+            }
+            running[pid] = runNumber;
+        }
+
+        int status = 0;
+        pid_t pid = wait(&status);
+        if (pid < 0) break;
+        auto it = running.find(pid);
+        if (it == running.end()) continue;
+        bool ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+        if (!ok) {
+            failed++;
+            fprintf(stderr, "ForkCmdenv: run #%d (pid %d) failed with status %d\n", it->second, (int)pid, status);
+        }
+        running.erase(it);
+    }
+    return failed;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <omnetpp.h>
+#include "cmdenv/cmdenv.h"
+
+// ====== FORK SERVER ======
+// Cmdenv that shares one loaded image across all runs of a sweep.
+//
+//   ../src/benchmark_forkserver -n .:../src -c Replay -r 0..999 --fork-workers=8
+//
+// Built as its own executable ("make forkserver" in src/), so the model and
+// opp_run -l ../src/benchmark keep the stock main and public OMNeT++ headers only;
+// this class relies on Cmdenv internals (cmdenv/cmdenv.h, opt, args, doRun).
+//
+// By the time doRun() is reached, the shared libraries (INET, Veins) are mapped and
+// every NED file on the NED path is parsed. Instead of running the selected runs one
+// after another, the parent forks one child per run, at most fork-workers at a time,
+// and only waits for them. Each child runs its single run with plain Cmdenv on a
+// copy-on-write image of the parent, so neither the libraries nor the NED types are
+// loaded again. Use cmdenv-redirect-output = true to keep the children's output apart.
+// One configuration per invocation (-c); the parent reports on stderr only.
+// benchmark-log-file must differ per run (e.g. contain ${runnumber}): every child opens
+// its log fresh, so a shared name would be truncated and interleaved. Such a
+// configuration is rejected before anything is forked.
+//
+// The run filter must not reach Cmdenv as "-r" (it would override the child's own run),
+// so main() takes it out of the argument list and hands it over in runFilterArg.
+class ForkingCmdenv : public omnetpp::cmdenv::Cmdenv
+{
+  public:
+    static std::string runFilterArg;
+
+  protected:
+    virtual void doRun() override;
+
+  private:
+    bool isChild = false;
+
+    void checkLogFiles(const std::vector<int>& runNumbers);
+    int forkRuns(const std::vector<int>& runNumbers, int workers);
+};
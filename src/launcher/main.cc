@@ -0,0 +1,42 @@
+#include <cstring>
+#include <vector>
+#include "envir/envirdefs.h"
+#include "launcher/ForkingCmdenv.h"
+
+namespace omnetpp {
+namespace envir {
+ENVIR_API int evMain(int argc, char *argv[]);
+} // namespace envir
+} // namespace omnetpp
+
+// main of the benchmark_forkserver executable (in place of liboppmain's).
+// Selects ForkCmdenv unless another user interface is asked for with -u, in which
+// case the arguments are passed through unchanged. With ForkCmdenv the run filter
+// ("-r X" or "-rX") is taken out for ForkingCmdenv, which applies it in the parent
+// and gives each child its own.
+int main(int argc, char *argv[])
+{
+    const char *userInterface = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-u") && i + 1 < argc) userInterface = argv[i + 1];
+        else if (!strncmp(argv[i], "-u", 2) && argv[i][2]) userInterface = argv[i] + 2;
+    }
+    if (userInterface && strcmp(userInterface, "ForkCmdenv")) return omnetpp::envir::evMain(argc, argv);
+
+    static char userInterfaceOption[] = "-uForkCmdenv";
+    std::vector<char *> args;
+    for (int i = 0; i < argc; i++) {
+        if (!strcmp(argv[i], "-r") && i + 1 < argc) {
+            ForkingCmdenv::runFilterArg = argv[++i];
+        }
+        else if (!strncmp(argv[i], "-r", 2) && argv[i][2]) {
+            ForkingCmdenv::runFilterArg = argv[i] + 2;
+        }
+        else {
+            args.push_back(argv[i]);
+        }
+        if (i == 0 && !userInterface) args.push_back(userInterfaceOption);
+    }
+    args.push_back(nullptr);
+    return omnetpp::envir::evMain(args.size() - 1, args.data());
+}
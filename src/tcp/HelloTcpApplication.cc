@@ -1,29 +1,64 @@
 #include "tcp/HelloTcpApplication.h"
-#include <iostream>
+#include <algorithm>
+#include <cmath>
 #include <vector>
 #include "inet/common/packet/Packet.h"
-#include "inet/common/packet/chunk/BytesChunk.h"
-#include "inet/networklayer/common/L3AddressResolver.h"
+#include "inet/common/ModuleAccess.h"
+#include "common/CompletionCoordinator.h"
+#include "common/NeighborTable.h"
+#include "common/PeerDirectory.h"
+#include "common/HelloPacket_m.h"
+#include "common/ProtocolLog.h"
 
 using namespace inet;
 
 Define_Module(HelloTcpApplication);
 
+const simsignal_t HelloTcpApplication::helloSentSignal = registerSignal("helloSent");
+const simsignal_t HelloTcpApplication::helloReceivedSignal = registerSignal("helloReceived");
+const simsignal_t HelloTcpApplication::connectionEstablishedSignal = registerSignal("connectionEstablished");
+const simsignal_t HelloTcpApplication::completionTimeSignal = registerSignal("completionTime");
+const simsignal_t HelloTcpApplication::helloAttemptsSignal = registerSignal("helloAttempts");
+const simsignal_t HelloTcpApplication::timedOutSignal = registerSignal("timedOut");
+const simsignal_t HelloTcpApplication::connectionAttemptsSignal = registerSignal("connectionAttempts");
+const simsignal_t HelloTcpApplication::connectSkippedSignal = registerSignal("connectSkipped");
+const simsignal_t HelloTcpApplication::synToEstablishedSignal = registerSignal("synToEstablished");
+const simsignal_t HelloTcpApplication::connectToEstablishedSignal = registerSignal("connectToEstablished");
+const simsignal_t HelloTcpApplication::connectRetriesSignal = registerSignal("connectRetries");
+const simsignal_t HelloTcpApplication::helloDeliverySignal = registerSignal("helloDelivery");
+
 HelloTcpApplication::HelloTcpApplication() {}
 
 HelloTcpApplication::~HelloTcpApplication()
 {
-    for (auto& kv : clientSockets) {
-        delete kv.second;
+    socketMap.deleteSockets();
+    for (auto& kv : connections) {
+        delete kv.second.txPending;
+    }
+    for (TcpSocket* socket : releasedSockets) {
+        delete socket;
     }
-    for (auto& kv : serverSockets) {
-        delete kv.second;
+    for (TcpSocket* socket : socketPool) {
+        delete socket;
     }
 }
 
 bool HelloTcpApplication::startApplication()
 {
     myId = getParentModule()->getIndex();
+    totalVehicles = par("numVehicles");
+    scanInterval = par("scanInterval");
+    backoffBase = par("backoffBase");
+    backoffMax = par("backoffMax");
+    backoffJitter = par("backoffJitter");
+    if (scanInterval <= SimTime(0)) throw cRuntimeError("scanInterval must be positive");
+
+    std::string connectGate = par("connectGate").stdstringValue();
+    if (connectGate == "range") predictedGate = false;
+    else if (connectGate == "predicted") predictedGate = true;
+    else throw cRuntimeError("Unknown connectGate '%s'", connectGate.c_str());
+    handshakeTime = par("handshakeTime");
+    predictionHorizon = par("predictionHorizon");
 
     // GET MOBILITY MODULE
     mobility = check_and_cast<veins::VeinsInetMobility*>(getParentModule()->getSubmodule("mobility"));
@@ -32,16 +67,42 @@ bool HelloTcpApplication::startApplication()
     traci = mobility->getCommandInterface();
     traciVehicle = mobility->getVehicleCommandInterface();
 
-    sentHelloTo.clear();
+    sentHelloTo.reset(totalVehicles);
     sentHelloTo.insert(myId);
 
-    connectedPeers.clear();
+    peerLinks.assign(totalVehicles, PeerLink());
+    peerSockets.assign(totalVehicles, nullptr);
+
+    std::string connectionMode = par("connectionMode").stdstringValue();
+    if (connectionMode == "perDirection") connectionPerPair = false;
+    else if (connectionMode == "perPair") connectionPerPair = true;
+    else throw cRuntimeError("Unknown connectionMode '%s'", connectionMode.c_str());
+
+    std::string completion = par("completion").stdstringValue();
+    if (completion == "fleet") inRangeCompletion = false;
+    else if (completion == "inRange") inRangeCompletion = true;
+    else throw cRuntimeError("Unknown completion '%s'", completion.c_str());
+
+    neighborTable = findModuleFromPar<NeighborTable>(par("neighborTableModule"), this);
+    if (inRangeCompletion && !neighborTable) throw cRuntimeError("completion=\"inRange\" needs a NeighborTable (neighborTableModule)");
+    if (predictedGate && !neighborTable) throw cRuntimeError("connectGate=\"predicted\" needs a NeighborTable (neighborTableModule)");
+    if (neighborTable) neighborTable->registerVehicle(myId, mobility);
+    expectedPeers.reset(totalVehicles);
+
+    // Peers are looked up by id; our own address is published for them
+    peerDirectory = findModuleFromPar<PeerDirectory>(par("peerDirectoryModule"), this);
+    if (!peerDirectory) throw cRuntimeError("No PeerDirectory found at '%s'", par("peerDirectoryModule").stringValue());
+    peerDirectory->registerPeer(myId, getParentModule());
+
+    coordinator = findModuleFromPar<CompletionCoordinator>(par("coordinatorModule"), this);
+    if (coordinator) coordinator->reportStarted(myId);
 
     stopSending = false;
 
     helloAttempts = 0;
     connectionAttempts = 0;
     startTime = simTime();
+    oneWayHistograms.reset(totalVehicles);
 
     // Setup TCP server socket to accept incoming connections
     serverSocket.setOutputGate(gate("socketOut"));
@@ -49,124 +110,222 @@ bool HelloTcpApplication::startApplication()
     serverSocket.bind(TCP_PORT);
     serverSocket.listen();
 
-    std::cout << simTime() << " Vehicle " << myId
-              << " STARTED (TCP mode) listening on port " << TCP_PORT << std::endl;
+    PROTOCOL_LOG(PLOG_EVENTS, ProtocolEvent::TCP_LISTEN, myId, -1, TCP_PORT);
 
-    // SCHEDULE PERIODIC CHECK FOR INTERSECTION - METHOD 3
-    checkPositionHandle = timerManager.create(
-        veins::TimerSpecification([this]() {
-            checkAndStopAtIntersection();
-        }).interval(checkInterval)
-    );
+    // Stop in the intersection zone: pushed by the geofence service, no polling
+    geofence = findModuleFromPar<GeofenceService>(par("geofenceModule"), this);
+    if (geofence) {
+        stopZoneId = geofence->findZone(par("stopZone").stdstringValue());
+        if (stopZoneId == -1) throw cRuntimeError("Geofence zone '%s' is not defined", par("stopZone").stringValue());
+        geofence->subscribe(mobility, this);
+    }
 
-    // Start connecting to peers after initial delay
-    scheduleConnect(initDelay);
+    // Connect to peers as soon as they are plausibly in range
+    scheduleScan(SimTime(0));
 
     return true;
 }
 
 bool HelloTcpApplication::stopApplication()
 {
-    if (connectHandle != -1) {
-        timerManager.cancel(connectHandle);
-        connectHandle = -1;
-    }
+    cancelTimers();
 
-    if (checkPositionHandle != -1) {
-        timerManager.cancel(checkPositionHandle);
-        checkPositionHandle = -1;
-    }
+    if (geofence) geofence->unsubscribe(mobility, this);
 
     serverSocket.close();
 
-    for (auto& kv : clientSockets) {
-        kv.second->close();
-    }
-
-    for (auto& kv : serverSockets) {
+    for (auto& kv : socketMap.getMap()) {
         kv.second->close();
     }
 
     return true;
 }
 
-void HelloTcpApplication::checkAndStopAtIntersection()
+void HelloTcpApplication::handleMessageWhenUp(cMessage *msg)
 {
-    if (hasStoppedAtIntersection || !traciVehicle) {
-        return;
+    if (timerManager.handleMessage(msg)) return;
+
+    // Indications are routed by the socket id they carry
+    if (ISocket* connSocket = socketMap.findSocketFor(msg)) {
+        connSocket->processMessage(msg);
+    }
+    else if (serverSocket.belongsToSocket(msg)) {
+        serverSocket.processMessage(msg);
+    }
+    else if (socket.belongsToSocket(msg)) {
+        socket.processMessage(msg);
+    }
+    else {
+        EV_WARN << "Ignoring message for unknown socket: " << msg->getName() << endl;
+        delete msg;
     }
 
-    try {
-        // Get current road/edge ID
-        std::string roadId = traciVehicle->getRoadId();
-
-        // Check if vehicle is on one of the intersection edges
-        if (INTERSECTION_EDGES.count(roadId) > 0) {
-            // Vehicle is at intersection - STOP IT
-            traciVehicle->setSpeed(0);
-            hasStoppedAtIntersection = true;
-
-            Coord pos = mobility->getCurrentPosition();
-            std::cout << simTime() << " Vehicle " << myId
-                      << " STOPPED at intersection on edge: " << roadId
-                      << " at position " << pos << std::endl;
-
-            // Cancel the position check timer since we've stopped
-            if (checkPositionHandle != -1) {
-                timerManager.cancel(checkPositionHandle);
-                checkPositionHandle = -1;
-            }
-        }
-    } catch (const std::exception& e) {
-        std::cerr << "Error checking position for Vehicle " << myId
-                  << ": " << e.what() << std::endl;
+    // Everything this event queued for a connection goes out as one send
+    flushMessages();
+
+    // Safe now: no socket callback is running any more
+    recycleReleasedSockets();
+}
+
+void HelloTcpApplication::finish()
+{
+    if (geofence) geofence->unsubscribe(mobility, this);
+
+    emit(helloAttemptsSignal, helloAttempts);
+    emit(connectionAttemptsSignal, connectionAttempts);
+    oneWayHistograms.recordScalars(this, "oneWayLatency");
+    if (neighborTable) neighborTable->unregisterVehicle(myId);
+    if (peerDirectory) peerDirectory->unregisterPeer(myId);
+
+    emit(timedOutSignal, !stopSending);
+    if (!stopSending) {
+        PROTOCOL_LOG(PLOG_SUMMARY, ProtocolEvent::TIMEOUT, myId, -1, helloAttempts, sentHelloTo.count());
     }
+
+    VeinsInetApplicationBase::finish();
+}
+
+void HelloTcpApplication::zoneEntered(int zoneId)
+{
+    Enter_Method_Silent();
+
+    if (zoneId != stopZoneId || hasStoppedAtIntersection) return;
+
+    // Vehicle is at intersection - STOP IT
+    // (when replaying a trace there is no TraCI; the recorded positions already include the stop)
+    if (traciVehicle) traciVehicle->setSpeed(0);
+    hasStoppedAtIntersection = true;
+
+    Coord pos = mobility->getCurrentPosition();
+    PROTOCOL_LOG(PLOG_EVENTS, ProtocolEvent::STOPPED_AT_INTERSECTION, myId, -1, 0, 0, pos.x, pos.y);
+
+    // Nothing left to watch for
+    geofence->unsubscribe(mobility, this);
 }
 
-void HelloTcpApplication::scheduleConnect(simtime_t delay)
+void HelloTcpApplication::scheduleScan(simtime_t delay)
 {
     if (stopSending) return;
 
-    connectHandle = timerManager.create(
+    scanHandle = timerManager.create(
         veins::TimerSpecification([this]() {
+            scanHandle = -1;
             if (!stopSending) {
-                connectToPeers();
-                scheduleConnect(connectRetry);
+                scanPeers();
+                scheduleScan(scanInterval);
             }
         }).oneshotIn(delay)
     );
 }
 
-void HelloTcpApplication::connectToPeers()
+void HelloTcpApplication::scanPeers()
 {
-    connectionAttempts++;
+    // In range mode the expected set may have shrunk to what we already reached
+    if (isComplete()) {
+        completeProtocol();
+        return;
+    }
 
-    // Try to connect to all other vehicles
-    for (int peerId = 0; peerId < TOTAL_VEHICLES; peerId++) {
+    // Only idle peers are looked at; failed ones come back through their backoff timer.
+    // With one connection per pair the lower id connects and the higher one answers over it.
+    for (int peerId = connectionPerPair ? myId + 1 : 0; peerId < totalVehicles; peerId++) {
         if (peerId == myId) continue;
-        if (connectedPeers.count(peerId)) continue;
-        if (sentHelloTo.count(peerId)) continue;
+        if (peerLinks[peerId].state == PEER_IDLE) tryConnect(peerId);
+    }
+}
+
+void HelloTcpApplication::tryConnect(int peerId)
+{
+    if (stopSending || sentHelloTo.contains(peerId)) return;
+
+    // Not plausibly reachable yet: the next scan looks again
+    if (!linkAvailable(peerId)) return;
+    const L3Address& peerAddr = peerDirectory->getAddress(peerId);
+    if (peerAddr.isUnspecified()) return;  // not registered yet (or gone)
+
+    TcpSocket* socket = acquireSocket();
+
+    peerSockets[peerId] = socket;
+    connections[socket->getSocketId()].peerId = peerId;
+    socketMap.addSocket(socket);
+    PeerLink& link = peerLinks[peerId];
+    link.state = PEER_CONNECTING;
+    link.attempts++;
+    link.connectTime = simTime();
+    if (link.firstConnectTime < SIMTIME_ZERO) link.firstConnectTime = simTime();
+    connectionAttempts++;
+
+    PROTOCOL_LOG(PLOG_EVENTS, ProtocolEvent::TCP_CONNECT, myId, peerId, TCP_PORT);
+
+    socket->connect(peerAddr, TCP_PORT);
+}
+
+void HelloTcpApplication::scheduleReconnect(int peerId)
+{
+    PeerLink& link = peerLinks[peerId];
+    link.failures++;
+
+    // base * 2^(failures-1), capped, and jittered so that peers that failed together do not retry together
+    double delay = backoffBase.dbl() * std::ldexp(1.0, std::min(link.failures - 1, 30));
+    delay = std::min(delay, backoffMax.dbl()) * uniform(1 - backoffJitter, 1 + backoffJitter);
+
+    scheduleRetry(peerId, PEER_BACKOFF, delay);
+}
 
-        // Check if socket already exists
-        if (clientSockets.find(peerId) == clientSockets.end()) {
-            // Create new client socket
-            TcpSocket* socket = new TcpSocket();
-            socket->setOutputGate(gate("socketOut"));
-            socket->setCallback(this);
+void HelloTcpApplication::scheduleRetry(int peerId, PeerState state, simtime_t delay)
+{
+    PeerLink& link = peerLinks[peerId];
+    link.state = state;
+    link.retryHandle = timerManager.create(
+        veins::TimerSpecification([this, peerId]() {
+            PeerLink& link = peerLinks[peerId];
+            link.retryHandle = -1;
+            link.state = PEER_IDLE;
+            tryConnect(peerId);
+        }).oneshotIn(delay)
+    );
+}
 
-            clientSockets[peerId] = socket;
-            socketToPeerId[socket] = peerId;
-            socketMap.addSocket(socket);
+bool HelloTcpApplication::linkAvailable(int peerId)
+{
+    if (!neighborTable) return true;
+    if (!predictedGate) return neighborTable->inRange(myId, peerId);
+
+    PeerLink& link = peerLinks[peerId];
+    double enterIn, lifetime;
+    if (!neighborTable->predictLink(myId, peerId, enterIn, lifetime)) {
+        link.skipped = false;
+        return false;
+    }
 
-            // Get peer IP address
-            std::string peerIp = PEER_IPS[peerId];
-            L3Address peerAddr = L3AddressResolver().resolve(peerIp.c_str());
+    // Not worth a SYN if the link is gone before the handshake is through.
+    // Counted once when that starts, not on every scan that finds it still too short.
+    if (lifetime < handshakeTime.dbl()) {
+        if (!link.skipped) emit(connectSkippedSignal, peerId);
+        link.skipped = true;
+        return false;
+    }
+    link.skipped = false;
 
-            std::cout << simTime() << " Vehicle " << myId
-                      << " CONNECTING to Vehicle " << peerId
-                      << " at " << peerAddr << ":" << TCP_PORT << std::endl;
+    // Coming into range soon: wake up right then instead of waiting for a later scan
+    // (below a millisecond counts as now, the positions only move at mobility updates anyway)
+    if (enterIn > 1e-3) {
+        if (enterIn <= predictionHorizon.dbl()) scheduleRetry(peerId, PEER_WAITING, enterIn);
+        return false;
+    }
+    return true;
+}
 
-            socket->connect(peerAddr, TCP_PORT);
+void HelloTcpApplication::cancelTimers()
+{
+    if (scanHandle != -1) {
+        timerManager.cancel(scanHandle);
+        scanHandle = -1;
+    }
+    for (PeerLink& link : peerLinks) {
+        if (link.retryHandle != -1) {
+            timerManager.cancel(link.retryHandle);
+            link.retryHandle = -1;
         }
     }
 }
@@ -180,12 +339,10 @@ void HelloTcpApplication::socketAvailable(TcpSocket *socket, TcpAvailableInfo *a
 
     serverSocket.accept(availableInfo->getNewSocketId());
 
-    int connId = nextConnId++;
-    serverSockets[connId] = newSocket;
     socketMap.addSocket(newSocket);
+    connections[newSocket->getSocketId()];  // peer learned from its first HELLO
 
-    std::cout << simTime() << " Vehicle " << myId
-              << " ACCEPTED incoming connection (connId=" << connId << ")" << std::endl;
+    PROTOCOL_LOG(PLOG_EVENTS, ProtocolEvent::TCP_ACCEPT, myId, -1, newSocket->getSocketId());
 
 //    delete availableInfo;
 }
@@ -193,13 +350,19 @@ void HelloTcpApplication::socketAvailable(TcpSocket *socket, TcpAvailableInfo *a
 void HelloTcpApplication::socketEstablished(TcpSocket *socket)
 {
     // Check if this is a client socket we initiated
-    auto it = socketToPeerId.find(socket);
-    if (it != socketToPeerId.end()) {
-        int peerId = it->second;
-        connectedPeers.insert(peerId);
+    int peerId = peerOf(socket);
+    if (peerId != -1) {
+        PeerLink& link = peerLinks[peerId];
+        link.state = PEER_CONNECTED;
+        link.failures = 0;
+
+        // Where the handshake time went: this SYN, and everything since the first one (failed attempts, backoff)
+        emit(synToEstablishedSignal, simTime() - link.connectTime);
+        emit(connectToEstablishedSignal, simTime() - link.firstConnectTime);
+        emit(connectRetriesSignal, link.attempts - 1);
 
-        std::cout << simTime() << " Vehicle " << myId
-                  << " CONNECTED to Vehicle " << peerId << std::endl;
+        PROTOCOL_LOG(PLOG_EVENTS, ProtocolEvent::TCP_ESTABLISHED, myId, peerId);
+        emit(connectionEstablishedSignal, peerId);
 
         // Send HELLO immediately
         sendHelloTcp(peerId, socket);
@@ -209,69 +372,113 @@ void HelloTcpApplication::socketEstablished(TcpSocket *socket)
 void HelloTcpApplication::sendHelloTcp(int peerId, TcpSocket* socket)
 {
     if (stopSending) return;
-    if (sentHelloTo.count(peerId)) return;
+    if (sentHelloTo.contains(peerId)) return;
 
     helloAttempts++;
 
-    std::string msg = "hello-from-" + std::to_string(myId);
-    std::vector<uint8_t> bytes(msg.begin(), msg.end());
-
-    auto chunk = makeShared<BytesChunk>(bytes);
-    auto packet = new Packet("tcp-hello");
-    packet->insertAtBack(chunk);
+    auto chunk = makeShared<HelloPacket>();
+    chunk->setType(HELLO_MSG_HELLO);
+    chunk->setSenderId(myId);
+    chunk->setTargetId(peerId);
+    chunk->setSequenceNumber(helloAttempts);
+    chunk->setCreationTime(simTime());
 
-    socket->send(packet);
+    queueMessage(socket, chunk);
 
     sentHelloTo.insert(peerId);
+    emit(helloSentSignal, helloAttempts);
+    if (coordinator) coordinator->reportProgress(myId);
+    if (neighborTable) neighborTable->reportDiscovered(myId, peerId);
 
-    std::cout << simTime() << " Vehicle " << myId
-              << " SENDING HELLO #" << helloAttempts
-              << " to Vehicle " << peerId << " (TCP)"
-              << " | sent " << setToString(sentHelloTo)
-              << " | pending " << pendingToString()
-              << std::endl;
+    PROTOCOL_LOG(PLOG_EVENTS, ProtocolEvent::HELLO_TX, myId, peerId, helloAttempts, sentHelloTo.count());
 
     // Check completion
-    if ((int)sentHelloTo.size() >= TOTAL_VEHICLES) {
-        stopSending = true;
-        if (connectHandle != -1) {
-            timerManager.cancel(connectHandle);
-            connectHandle = -1;
-        }
+    if (isComplete()) completeProtocol();
+}
+
+bool HelloTcpApplication::isComplete()
+{
+    if (!inRangeCompletion) return sentHelloTo.full();
+
+    // HELLO delivered to every peer currently in range; with nobody in range there is nothing to complete yet
+    neighborTable->getNeighbors(myId, expectedPeers);
+    return expectedPeers.count() > 0 && sentHelloTo.containsAll(expectedPeers);
+}
 
-        endTime = simTime();
-        double duration = (endTime - startTime).dbl();
-
-        std::cout << "============================================" << std::endl;
-        std::cout << simTime() << " Vehicle " << myId
-                  << " COMPLETED PROTOCOL" << std::endl;
-        std::cout << "  Total HELLO attempts: " << helloAttempts << std::endl;
-        std::cout << "  Connection attempts: " << connectionAttempts << std::endl;
-        std::cout << "  Start time: " << startTime << "s" << std::endl;
-        std::cout << "  End time: " << endTime << "s" << std::endl;
-        std::cout << "  Duration: " << duration << "s" << std::endl;
-        std::cout << "  Sent to: " << setToString(sentHelloTo) << std::endl;
-        std::cout << "============================================" << std::endl;
+void HelloTcpApplication::completeProtocol()
+{
+    stopSending = true;
+    cancelTimers();
+
+    endTime = simTime();
+    double duration = (endTime - startTime).dbl();
+    emit(completionTimeSignal, endTime - startTime);
+    if (coordinator) coordinator->reportCompleted(myId);
+
+    PROTOCOL_LOG(PLOG_SUMMARY, ProtocolEvent::TCP_COMPLETED, myId, -1, helloAttempts, connectionAttempts, duration);
+}
+
+void HelloTcpApplication::queueMessage(TcpSocket* socket, const Ptr<const Chunk>& chunk)
+{
+    Connection& conn = connections[socket->getSocketId()];
+    if (!conn.txPending) {
+        conn.txPending = new Packet("tcp-hello");
+        txSockets.push_back(socket);
     }
+
+    auto header = makeShared<TcpFrameHeader>();
+    header->setLength(B(chunk->getChunkLength()).get());
+    conn.txPending->insertAtBack(header);
+    conn.txPending->insertAtBack(chunk);
 }
 
-void HelloTcpApplication::socketDataArrived(TcpSocket *socket, Packet *packet, bool urgent)
+void HelloTcpApplication::flushMessages()
 {
-    auto chunk = packet->peekDataAt<BytesChunk>(B(0), packet->getDataLength());
-    std::vector<uint8_t> bytes = chunk->getBytes();
-    std::string msg(bytes.begin(), bytes.end());
+    for (TcpSocket* socket : txSockets) {
+        // The connection may have been released since the message was queued
+        auto it = connections.find(socket->getSocketId());
+        if (it == connections.end() || !it->second.txPending) continue;
+        socket->send(it->second.txPending);
+        it->second.txPending = nullptr;
+    }
+    txSockets.clear();
+}
 
+void HelloTcpApplication::socketDataArrived(TcpSocket *socket, Packet *packet, bool urgent)
+{
+    // TCP delivers a byte stream: a packet may hold part of a message or several of them
+    Connection& conn = connections[socket->getSocketId()];
+    conn.rxQueue.push(packet->peekData());
     delete packet;
 
-    if (msg.rfind("hello-from-", 0) == 0) {
-        try {
-            int senderId = std::stoi(msg.substr(11));
+    while (conn.rxQueue.has<TcpFrameHeader>()) {
+        B length = B(conn.rxQueue.peek<TcpFrameHeader>()->getLength());
+        if (conn.rxQueue.getLength() < B(TCP_FRAME_HEADER_BYTES) + length) break;
 
-            std::cout << simTime() << " Vehicle " << myId
-                      << " RECEIVED HELLO from " << senderId
-                      << " (TCP)" << std::endl;
+        conn.rxQueue.pop<TcpFrameHeader>();
+        const auto& hello = conn.rxQueue.pop<HelloPacket>(length);
+        processHello(socket, *hello);
+    }
+}
 
-        } catch (...) {}
+void HelloTcpApplication::processHello(TcpSocket* socket, const HelloPacket& hello)
+{
+    if (hello.getType() != HELLO_MSG_HELLO) return;
+
+    int senderId = hello.getSenderId();
+    PROTOCOL_LOG(PLOG_EVENTS, ProtocolEvent::HELLO_RX, myId, senderId, hello.getSequenceNumber());
+    emit(helloReceivedSignal, senderId);
+    // From the send time stamped in the frame: ESTABLISHED on the connecting side, but for a
+    // perPair reply the moment the peer's HELLO arrived, so the reply's wait is not included
+    emit(helloDeliverySignal, simTime() - hello.getCreationTime());
+    oneWayHistograms.record(senderId, simTime() - hello.getCreationTime());
+
+    // One connection per pair: the accepted connection is also ours to the sender, answer over it
+    if (connectionPerPair && senderId >= 0 && senderId < myId && !peerSockets[senderId]) {
+        connections[socket->getSocketId()].peerId = senderId;
+        peerSockets[senderId] = socket;
+        peerLinks[senderId].state = PEER_CONNECTED;
+        sendHelloTcp(senderId, socket);
     }
 }
 
@@ -282,50 +489,70 @@ void HelloTcpApplication::socketPeerClosed(TcpSocket *socket)
 
 void HelloTcpApplication::socketClosed(TcpSocket *socket)
 {
-    std::cout << simTime() << " Vehicle " << myId
-              << " TCP socket CLOSED" << std::endl;
+    PROTOCOL_LOG(PLOG_EVENTS, ProtocolEvent::TCP_CLOSED, myId, peerOf(socket));
+    releaseSocket(socket);
 }
 
 void HelloTcpApplication::socketFailure(TcpSocket *socket, int code)
 {
-    std::cout << simTime() << " Vehicle " << myId
-              << " TCP socket FAILURE code=" << code << std::endl;
+    PROTOCOL_LOG(PLOG_EVENTS, ProtocolEvent::TCP_FAILURE, myId, peerOf(socket), code);
 
-    // Find which peer this was for
-    auto it = socketToPeerId.find(socket);
-    if (it != socketToPeerId.end()) {
-        int peerId = it->second;
-        std::cout << "  -> Failed connection to Vehicle " << peerId << std::endl;
+    // Frees the peer's slot and puts it into backoff
+    releaseSocket(socket);
+}
+
+int HelloTcpApplication::peerOf(TcpSocket* socket) const
+{
+    auto it = connections.find(socket->getSocketId());
+    return it != connections.end() ? it->second.peerId : -1;
+}
 
-        // Remove from connected set so we can retry
-        connectedPeers.erase(peerId);
+TcpSocket* HelloTcpApplication::acquireSocket()
+{
+    if (!socketPool.empty()) {
+        TcpSocket* socket = socketPool.back();
+        socketPool.pop_back();
+        return socket;
     }
+
+    TcpSocket* socket = new TcpSocket();
+    socket->setOutputGate(gate("socketOut"));
+    socket->setCallback(this);
+    return socket;
 }
 
-std::string HelloTcpApplication::setToString(const std::set<int>& s) const
+void HelloTcpApplication::releaseSocket(TcpSocket* socket)
 {
-    std::string out = "{";
-    bool first = true;
-    for (int x : s) {
-        if (!first) out += ",";
-        out += std::to_string(x);
-        first = false;
+    if (!socketMap.removeSocket(socket)) return;  // already released
+
+    auto it = connections.find(socket->getSocketId());
+    if (it != connections.end()) {
+        int peerId = it->second.peerId;
+        if (peerId != -1 && peerSockets[peerId] == socket) {
+            peerSockets[peerId] = nullptr;
+            if (sentHelloTo.contains(peerId)) peerLinks[peerId].state = PEER_DONE;
+            else if (initiates(peerId) && !stopSending) scheduleReconnect(peerId);
+            else peerLinks[peerId].state = PEER_IDLE;
+        }
+        delete it->second.txPending;
+        connections.erase(it);
     }
-    out += "}";
-    return out;
+
+    releasedSockets.push_back(socket);
 }
 
-std::string HelloTcpApplication::pendingToString() const
+void HelloTcpApplication::recycleReleasedSockets()
 {
-    std::string out = "{";
-    bool first = true;
-    for (int id = 0; id < TOTAL_VEHICLES; id++) {
-        if (sentHelloTo.find(id) == sentHelloTo.end()) {
-            if (!first) out += ",";
-            out += std::to_string(id);
-            first = false;
+    // Accepted sockets are recycled too: renewSocket() turns any socket into a fresh unbound one.
+    // The pool never holds more than one socket per peer, which bounds memory over long runs.
+    for (TcpSocket* socket : releasedSockets) {
+        if ((int)socketPool.size() < totalVehicles) {
+            socket->renewSocket();
+            socketPool.push_back(socket);
+        }
+        else {
+            delete socket;
         }
     }
-    out += "}";
-    return out;
+    releasedSockets.clear();
 }
@@ -1,16 +1,25 @@
 #pragma once
-#include <set>
-#include <map>
 #include <string>
+#include <unordered_map>
+#include <vector>
 #include "veins_inet/VeinsInetApplicationBase.h"
+#include "common/GeofenceService.h"
+#include "common/LatencyHistogram.h"
+#include "common/PeerSet.h"
 #include "inet/transportlayer/contract/tcp/TcpSocket.h"
 #include "inet/common/socket/SocketMap.h"
+#include "inet/common/packet/ChunkQueue.h"
 #include "veins_inet/VeinsInetMobility.h"
 #include "veins/modules/mobility/traci/TraCICommandInterface.h"
 
 using namespace inet;
 
-class HelloTcpApplication : public veins::VeinsInetApplicationBase, public TcpSocket::ICallback
+class CompletionCoordinator;
+class NeighborTable;
+class PeerDirectory;
+class HelloPacket;
+
+class HelloTcpApplication : public veins::VeinsInetApplicationBase, public TcpSocket::ICallback, public IGeofenceListener
 {
   public:
     HelloTcpApplication();
@@ -19,6 +28,8 @@ class HelloTcpApplication : public veins::VeinsInetApplicationBase, public TcpSo
   protected:
     virtual bool startApplication() override;
     virtual bool stopApplication() override;
+    virtual void finish() override;
+    virtual void handleMessageWhenUp(cMessage *msg) override;
 
     // TcpSocket::ICallback methods
     virtual void socketDataArrived(TcpSocket *socket, Packet *packet, bool urgent) override;
@@ -30,59 +41,126 @@ class HelloTcpApplication : public veins::VeinsInetApplicationBase, public TcpSo
     virtual void socketStatusArrived(TcpSocket *socket, TcpStatusInfo *status) override {}
     virtual void socketDeleted(TcpSocket *socket) override {}
 
+    // IGeofenceListener methods
+    virtual void zoneEntered(int zoneId) override;
+    virtual void zoneExited(int zoneId) override {}
+
   private:
     // ====== CONFIG ======
-    static constexpr int TOTAL_VEHICLES = 4;
+    int totalVehicles = 4;                         // NED parameter numVehicles
+    bool inRangeCompletion = false;                // NED parameter completion
+    bool connectionPerPair = false;                // NED parameter connectionMode
     const int TCP_PORT = 9001;
-    const simtime_t connectRetry = SimTime(0.5);
-    const simtime_t initDelay = SimTime(5.0);
-    const simtime_t checkInterval = SimTime(0.1);  // Check position every 0.1s
-
-    // Hardcoded peer IPs (10.0.0.1 to 10.0.0.4)
-    const std::vector<std::string> PEER_IPS = {
-        "10.0.0.1", "10.0.0.2", "10.0.0.3", "10.0.0.4"
-    };
-
-    // Intersection edges from your routes (C2S, C2N, C2E, C2W)
-    const std::set<std::string> INTERSECTION_EDGES = {
-        "C2S", "C2N", "C2E", "C2W"
-    };
+    simtime_t scanInterval;                        // NED parameter scanInterval
+    simtime_t backoffBase;                         // NED parameter backoffBase
+    simtime_t backoffMax;                          // NED parameter backoffMax
+    double backoffJitter = 0.5;                    // NED parameter backoffJitter
+    bool predictedGate = false;                    // NED parameter connectGate
+    simtime_t handshakeTime;                       // NED parameter handshakeTime
+    simtime_t predictionHorizon;                   // NED parameter predictionHorizon
 
     // ====== STATE ======
     int myId = -1;
     bool stopSending = false;
 
-    std::map<int, TcpSocket*> clientSockets;
-    std::map<int, TcpSocket*> serverSockets;
+    // Every open connection socket (outgoing and accepted) is in socketMap, keyed by socket id.
+    // Closed or failed ones are parked in releasedSockets until the indication that closed them
+    // has been processed, then renewed into socketPool for the next connect.
+    struct Connection
+    {
+        int peerId = -1;                // -1 for an accepted connection whose peer is not known yet
+        ChunkQueue rxQueue;             // received stream not yet cut into messages
+        Packet* txPending = nullptr;    // messages queued during this event, sent as one packet
+    };
     SocketMap socketMap;
     TcpSocket serverSocket;
+    std::vector<TcpSocket*> peerSockets;            // by peer id: the connection HELLOs to the peer go over, or nullptr
+    std::unordered_map<int, Connection> connections;  // by socket id
+    std::vector<TcpSocket*> txSockets;              // sockets with txPending set
+    std::vector<TcpSocket*> releasedSockets;
+    std::vector<TcpSocket*> socketPool;
 
-    std::set<int> connectedPeers;
-    std::set<int> sentHelloTo;
-    std::map<TcpSocket*, int> socketToPeerId;
+    // Connect state per peer we connect to:
+    //   IDLE -(registered, plausibly in range)-> CONNECTING -(established)-> CONNECTED
+    //   IDLE -(predicted to come into range)-> WAITING -(timer)-> IDLE
+    //   CONNECTING/CONNECTED -(closed or failed before the HELLO went out)-> BACKOFF -(timer)-> IDLE
+    //   closed after the HELLO went out -> DONE
+    enum PeerState
+    {
+        PEER_IDLE,
+        PEER_CONNECTING,
+        PEER_CONNECTED,
+        PEER_BACKOFF,
+        PEER_WAITING,
+        PEER_DONE
+    };
+    struct PeerLink
+    {
+        PeerState state = PEER_IDLE;
+        int failures = 0;        // consecutive failed attempts, sets the backoff
+        long retryHandle = -1;   // backoff or wait-for-link timer
+        bool skipped = false;    // connects currently skipped for a too short predicted link
+
+        // latency breakdown
+        int attempts = 0;               // connect() calls to this peer
+        simtime_t firstConnectTime = -1;  // first connect() to this peer
+        simtime_t connectTime = -1;       // connect() of the current attempt
+    };
+    std::vector<PeerLink> peerLinks;  // by peer id
 
-    long connectHandle = -1;
-    long checkPositionHandle = -1;  // Changed from stopHandle
-    int nextConnId = 1000;
+    PeerSet sentHelloTo;
+    CompletionCoordinator* coordinator = nullptr;  // NED parameter coordinatorModule, may be null
+    NeighborTable* neighborTable = nullptr;        // NED parameter neighborTableModule, may be null
+    PeerDirectory* peerDirectory = nullptr;        // NED parameter peerDirectoryModule
+    PeerSet expectedPeers;                         // in-range peers at the last completion check
+
+    long scanHandle = -1;
 
     // ====== BENCHMARKING ======
     int helloAttempts = 0;
     int connectionAttempts = 0;
     simtime_t startTime;
     simtime_t endTime;
+    PeerLatencyHistograms oneWayHistograms;  // HELLO creation -> received, by sender (TCP has no ACK frames, so no RTT)
+
+    static const simsignal_t helloSentSignal;
+    static const simsignal_t helloReceivedSignal;
+    static const simsignal_t connectionEstablishedSignal;
+    static const simsignal_t completionTimeSignal;
+    static const simsignal_t helloAttemptsSignal;
+    static const simsignal_t timedOutSignal;
+    static const simsignal_t connectionAttemptsSignal;
+    static const simsignal_t connectSkippedSignal;
+    static const simsignal_t synToEstablishedSignal;
+    static const simsignal_t connectToEstablishedSignal;
+    static const simsignal_t connectRetriesSignal;
+    static const simsignal_t helloDeliverySignal;
 
     // ====== MOBILITY ======
     veins::VeinsInetMobility* mobility = nullptr;
     veins::TraCICommandInterface* traci = nullptr;
     veins::TraCICommandInterface::Vehicle* traciVehicle = nullptr;
+    GeofenceService* geofence = nullptr;  // NED parameter geofenceModule, may be null
+    int stopZoneId = -1;                  // NED parameter stopZone
     bool hasStoppedAtIntersection = false;
 
   private:
-    void scheduleConnect(simtime_t delay);
-    void connectToPeers();
+    void scheduleScan(simtime_t delay);
+    void scanPeers();
+    bool initiates(int peerId) const { return !connectionPerPair || peerId > myId; }
+    void tryConnect(int peerId);
+    void scheduleReconnect(int peerId);
+    void scheduleRetry(int peerId, PeerState state, simtime_t delay);
+    bool linkAvailable(int peerId);
+    void cancelTimers();
     void sendHelloTcp(int peerId, TcpSocket* socket);
-    void checkAndStopAtIntersection();  // NEW METHOD
-
-    std::string setToString(const std::set<int>& s) const;
-    std::string pendingToString() const;
+    void processHello(TcpSocket* socket, const HelloPacket& hello);
+    void queueMessage(TcpSocket* socket, const Ptr<const Chunk>& chunk);
+    void flushMessages();
+    int peerOf(TcpSocket* socket) const;
+    TcpSocket* acquireSocket();
+    void releaseSocket(TcpSocket* socket);
+    void recycleReleasedSockets();
+    bool isComplete();
+    void completeProtocol();
 };
@@ -1,32 +1,66 @@
 #include "udp/HelloUdpApplication.h"
 
-#include <iostream>
-#include <vector>
-#include <algorithm>
-
 #include "inet/common/packet/Packet.h"
-#include "inet/common/packet/chunk/BytesChunk.h"
+#include "inet/common/ModuleAccess.h"
+#include "inet/common/TimeTag_m.h"
+#include "common/CompletionCoordinator.h"
+#include "common/NeighborTable.h"
+#include "common/HelloPacket_m.h"
+#include "common/ProtocolLog.h"
 
 using namespace inet;
 
 Define_Module(HelloUdpApplication);
 
+const simsignal_t HelloUdpApplication::helloSentSignal = registerSignal("helloSent");
+const simsignal_t HelloUdpApplication::helloReceivedSignal = registerSignal("helloReceived");
+const simsignal_t HelloUdpApplication::ackSentSignal = registerSignal("ackSent");
+const simsignal_t HelloUdpApplication::ackReceivedSignal = registerSignal("ackReceived");
+const simsignal_t HelloUdpApplication::completionTimeSignal = registerSignal("completionTime");
+const simsignal_t HelloUdpApplication::helloAttemptsSignal = registerSignal("helloAttempts");
+const simsignal_t HelloUdpApplication::timedOutSignal = registerSignal("timedOut");
+
 HelloUdpApplication::HelloUdpApplication() {}
 HelloUdpApplication::~HelloUdpApplication() {}
 
 bool HelloUdpApplication::startApplication()
 {
     myId = getParentModule()->getIndex();
+    totalVehicles = par("numVehicles");
+
+    std::string ackMode = par("ackMode").stdstringValue();
+    if (ackMode == "explicit") implicitAcks = false;
+    else if (ackMode == "implicit") implicitAcks = true;
+    else throw cRuntimeError("Unknown ackMode '%s'", ackMode.c_str());
 
     // Self is considered "acked" immediately (I don't need to ACK myself)
-    ackedSet.clear();
+    ackedSet.reset(totalVehicles);
     ackedSet.insert(myId);
+    heardFrom.reset(totalVehicles);
+
+    std::string completion = par("completion").stdstringValue();
+    if (completion == "fleet") inRangeCompletion = false;
+    else if (completion == "inRange") inRangeCompletion = true;
+    else throw cRuntimeError("Unknown completion '%s'", completion.c_str());
+
+    neighborTable = findModuleFromPar<NeighborTable>(par("neighborTableModule"), this);
+    if (inRangeCompletion && !neighborTable) throw cRuntimeError("completion=\"inRange\" needs a NeighborTable (neighborTableModule)");
+    if (neighborTable) neighborTable->registerVehicle(myId, mobility);
+    expectedPeers.reset(totalVehicles);
+
+    coordinator = findModuleFromPar<CompletionCoordinator>(par("coordinatorModule"), this);
+    if (coordinator) coordinator->reportStarted(myId);
 
     stopSendingHello = false;
 
     // Benchmarking
     helloAttempts = 0;
+    helloFramesSent = 0;
+    ackFramesSent = 0;
     startTime = simTime();
+    for (SentHello& h : sentHellos) h = SentHello();
+    rttHistograms.reset(totalVehicles);
+    oneWayHistograms.reset(totalVehicles);
 
     // Initial de-sync
     const double d = uniform(initMin.dbl(), initMax.dbl());
@@ -41,9 +75,30 @@ bool HelloUdpApplication::stopApplication()
         timerManager.cancel(helloHandle);
         helloHandle = -1;
     }
+    if (replyHandle != -1) {
+        timerManager.cancel(replyHandle);
+        replyHandle = -1;
+    }
     return true;
 }
 
+void HelloUdpApplication::finish()
+{
+    recordScalar("framesSent", helloFramesSent + ackFramesSent);
+    rttHistograms.recordScalars(this, "rtt");
+    oneWayHistograms.recordScalars(this, "oneWayLatency");
+
+    emit(helloAttemptsSignal, helloAttempts);
+    if (neighborTable) neighborTable->unregisterVehicle(myId);
+
+    emit(timedOutSignal, !stopSendingHello);
+    if (!stopSendingHello) {
+        PROTOCOL_LOG(PLOG_SUMMARY, ProtocolEvent::TIMEOUT, myId, -1, helloAttempts, ackedSet.count());
+    }
+
+    VeinsInetApplicationBase::finish();
+}
+
 void HelloUdpApplication::scheduleHello(simtime_t delay)
 {
     if (stopSendingHello) return;
@@ -68,182 +123,188 @@ void HelloUdpApplication::sendHello()
     helloAttempts++;
 
     // ONLY check ackedSet - stop sending when everyone has ACKed me
-    if ((int)ackedSet.size() >= TOTAL_VEHICLES) {
-        stopSendingHello = true;
-        if (helloHandle != -1) {
-            timerManager.cancel(helloHandle);
-            helloHandle = -1;
-        }
-        endTime = simTime();
-        double duration = (endTime - startTime).dbl();
-
-        std::cout << "============================================" << std::endl;
-        std::cout << simTime() << " Vehicle " << myId
-                  << " COMPLETED PROTOCOL" << std::endl;
-        std::cout << "  Total HELLO attempts: " << helloAttempts << std::endl;
-        std::cout << "  Start time: " << startTime << "s" << std::endl;
-        std::cout << "  End time: " << endTime << "s" << std::endl;
-        std::cout << "  Duration: " << duration << "s" << std::endl;
-        std::cout << "  Acked by: " << setToString(ackedSet) << std::endl;
-        std::cout << "============================================" << std::endl;
+    if (isComplete()) {
+        completeProtocol();
         return;
     }
 
-    std::string msg = "hello-from-" + std::to_string(myId);
+    broadcastHello();
 
-    std::vector<uint8_t> bytes(msg.begin(), msg.end());
-    auto payload = makeShared<BytesChunk>(bytes);
+    PROTOCOL_LOG(PLOG_EVENTS, ProtocolEvent::HELLO_TX, myId, -1, helloAttempts, ackedSet.count());
+}
+
+void HelloUdpApplication::broadcastHello()
+{
+    auto payload = makeShared<HelloPacket>();
+    payload->setType(HELLO_MSG_HELLO);
+    payload->setSenderId(myId);
+    payload->setSequenceNumber(helloAttempts);
+    payload->setCreationTime(simTime());
+    payload->setDone(stopSendingHello);
+
+    if (implicitAcks) {
+        // Piggyback everyone we have heard from; receivers find their own bit
+        int numBytes = heardFrom.byteCount();
+        payload->setHeardFromArraySize(numBytes);
+        for (int i = 0; i < numBytes; i++) {
+            payload->setHeardFrom(i, heardFrom.byteAt(i));
+        }
+        payload->setChunkLength(B(HELLO_PACKET_BYTES + HELLO_BITMAP_HEADER_BYTES + numBytes));
+    }
+    timestampPayload(payload);
 
-    auto packet = createPacket(msg.c_str());
+    auto packet = createPacket("hello");
     packet->insertAtBack(payload);
 
     sendPacket(std::move(packet));
 
-    std::cout << simTime() << " Vehicle " << myId
-              << " SENDING HELLO #" << helloAttempts
-              << " | acked " << setToString(ackedSet)
-              << " | pending ACK " << pendingAckToString()
-              << std::endl;
+    helloFramesSent++;
+    lastHelloSent = simTime();
+    SentHello& sent = sentHellos[helloAttempts % HELLO_HISTORY];
+    sent.seq = helloAttempts;
+    sent.time = simTime();
+    emit(helloSentSignal, helloAttempts);
+}
+
+void HelloUdpApplication::scheduleReplyHello()
+{
+    // Rate-limited to one HELLO per basePeriod, however many peers are still handshaking
+    if (replyHandle != -1) return;
+
+    simtime_t delay = lastHelloSent + basePeriod - simTime();
+    if (delay < SimTime(0)) delay = SimTime(0);
+    delay += SimTime(uniform(0.0, jitter.dbl()));
+
+    replyHandle = timerManager.create(
+        veins::TimerSpecification([this]() {
+            replyHandle = -1;
+            broadcastHello();
+        }).oneshotIn(delay)
+    );
 }
 
-void HelloUdpApplication::sendAck(int targetId)
+void HelloUdpApplication::completeProtocol()
 {
-    std::string msg = "ack-from-" + std::to_string(myId) + "-to-" + std::to_string(targetId);
+    stopSendingHello = true;
+    if (helloHandle != -1) {
+        timerManager.cancel(helloHandle);
+        helloHandle = -1;
+    }
+    endTime = simTime();
+    double duration = (endTime - startTime).dbl();
+    emit(completionTimeSignal, endTime - startTime);
+    if (coordinator) coordinator->reportCompleted(myId);
+
+    PROTOCOL_LOG(PLOG_SUMMARY, ProtocolEvent::COMPLETED, myId, -1, helloAttempts, helloFramesSent + ackFramesSent, duration);
 
-    std::vector<uint8_t> bytes(msg.begin(), msg.end());
-    auto payload = makeShared<BytesChunk>(bytes);
+    // Peers only learn that we heard them from our HELLOs, so advertise the final set once
+    if (implicitAcks) broadcastHello();
+}
 
-    auto packet = createPacket(msg.c_str());
+void HelloUdpApplication::sendAck(int targetId, uint32_t seqNum)
+{
+    auto payload = makeShared<HelloPacket>();
+    payload->setType(HELLO_MSG_ACK);
+    payload->setSenderId(myId);
+    payload->setTargetId(targetId);
+    payload->setSequenceNumber(seqNum);
+    payload->setCreationTime(simTime());
+    timestampPayload(payload);
+
+    auto packet = createPacket("ack");
     packet->insertAtBack(payload);
 
     sendPacket(std::move(packet));
 
-    std::cout << simTime() << " Vehicle " << myId
-              << " SENDING ACK to " << targetId
-              << std::endl;
+    ackFramesSent++;
+    emit(ackSentSignal, targetId);
+
+    PROTOCOL_LOG(PLOG_EVENTS, ProtocolEvent::ACK_TX, myId, targetId, seqNum);
 }
 
 void HelloUdpApplication::processPacket(std::shared_ptr<Packet> pk)
 {
-    std::string packetName = pk->getName();
+    const auto& payload = pk->peekAtFront<HelloPacket>();
 
-    // Determine if it's a HELLO or ACK message
-    if (packetName.rfind("hello-from-", 0) == 0) {
-        processHello(packetName);
-    } else if (packetName.rfind("ack-from-", 0) == 0) {
-        processAck(packetName);
+    for (auto& region : pk->peekData()->getAllTags<CreationTimeTag>()) {
+        oneWayHistograms.record(payload->getSenderId(), simTime() - region.getTag()->getCreationTime());
+    }
+
+    // Dispatch on the header type, no name parsing on the receive path
+    switch (payload->getType()) {
+        case HELLO_MSG_HELLO:
+            processHello(*payload);
+            break;
+        case HELLO_MSG_ACK:
+            processAck(*payload);
+            break;
     }
 }
 
-void HelloUdpApplication::processHello(const std::string& packetName)
+void HelloUdpApplication::processHello(const HelloPacket& hello)
 {
-    int sender = parseSenderId(packetName.c_str());
+    int sender = hello.getSenderId();
 
     if (sender >= 0 && sender != myId) {
-        std::cout << simTime() << " Vehicle " << myId
-                  << " RECEIVED HELLO from " << sender
-                  << std::endl;
+        PROTOCOL_LOG(PLOG_EVENTS, ProtocolEvent::HELLO_RX, myId, sender, hello.getSequenceNumber());
+        emit(helloReceivedSignal, sender);
+
+        if (!implicitAcks) {
+            // Always send ACK back when we receive a HELLO
+            // (even if we've stopped sending our own HELLOs)
+            sendAck(sender, hello.getSequenceNumber());
+            return;
+        }
 
-        // Always send ACK back when we receive a HELLO
-        // (even if we've stopped sending our own HELLOs)
-        sendAck(sender);
-    }
-}
+        heardFrom.insert(sender);
 
-void HelloUdpApplication::processAck(const std::string& packetName)
-{
-    // Parse "ack-from-X-to-Y"
-    // We only care if it's addressed to us (to-Y == myId)
-    size_t toPos = packetName.find("-to-");
-    if (toPos == std::string::npos) return;
-
-    try {
-        int targetId = std::stoi(packetName.substr(toPos + 4));
-        if (targetId != myId) return; // Not for us
-
-        size_t fromPos = packetName.find("ack-from-");
-        if (fromPos != 0) return;
-
-        std::string middle = packetName.substr(9, toPos - 9);
-        int sender = std::stoi(middle);
-
-        bool wasNew = (ackedSet.find(sender) == ackedSet.end());
-        ackedSet.insert(sender);
-
-        std::cout << simTime() << " Vehicle " << myId
-                  << " RECEIVED ACK from " << sender
-                  << " | acked " << setToString(ackedSet)
-                  << " | pending ACK " << pendingAckToString()
-                  << std::endl;
-
-        // Check if we should stop sending after receiving this ACK
-        if ((int)ackedSet.size() >= TOTAL_VEHICLES && !stopSendingHello) {
-            stopSendingHello = true;
-            if (helloHandle != -1) {
-                timerManager.cancel(helloHandle);
-                helloHandle = -1;
-            }
-            endTime = simTime();
-            double duration = (endTime - startTime).dbl();
-
-            std::cout << "============================================" << std::endl;
-            std::cout << simTime() << " Vehicle " << myId
-                      << " COMPLETED PROTOCOL" << std::endl;
-            std::cout << "  Total HELLO attempts: " << helloAttempts << std::endl;
-            std::cout << "  Start time: " << startTime << "s" << std::endl;
-            std::cout << "  End time: " << endTime << "s" << std::endl;
-            std::cout << "  Duration: " << duration << "s" << std::endl;
-            std::cout << "  Acked by: " << setToString(ackedSet) << std::endl;
-            std::cout << "============================================" << std::endl;
+        // Our own bit in the sender's heard-from bitmap is the ACK
+        size_t byte = myId >> 3;
+        if (byte < hello.getHeardFromArraySize() && ((hello.getHeardFrom(byte) >> (myId & 7)) & 1)) {
+            markAcked(sender);
         }
 
-    } catch (...) {
-        // Parse error, ignore
+        // A sender that is still handshaking may not have seen itself in our HELLOs yet.
+        // Completed senders are not answered, or two completed vehicles would keep answering each other.
+        if (stopSendingHello && !hello.getDone()) scheduleReplyHello();
     }
 }
 
-int HelloUdpApplication::parseSenderId(const char* name) const
+void HelloUdpApplication::processAck(const HelloPacket& ack)
 {
-    if (!name) return -1;
+    // We only care if it's addressed to us
+    if (ack.getTargetId() != myId) return;
 
-    std::string s(name);
-    const std::string prefix = "hello-from-";
+    int sender = ack.getSenderId();
+    if (sender < 0 || sender == myId) return;
 
-    if (s.rfind(prefix, 0) != 0) return -1;
+    // Every ACK echoes the sequence number of the HELLO it answers
+    const SentHello& sent = sentHellos[ack.getSequenceNumber() % HELLO_HISTORY];
+    if (sent.seq == ack.getSequenceNumber() && sent.time >= SIMTIME_ZERO) rttHistograms.record(sender, simTime() - sent.time);
 
-    try {
-        size_t start = prefix.size();
-        return std::stoi(s.substr(start));
-    } catch (...) {
-        return -1;
-    }
+    markAcked(sender);
 }
 
-std::string HelloUdpApplication::setToString(const std::set<int>& s) const
+void HelloUdpApplication::markAcked(int sender)
 {
-    std::string out = "{";
-    bool first = true;
-    for (int x : s) {
-        if (!first) out += ",";
-        out += std::to_string(x);
-        first = false;
+    if (!ackedSet.insert(sender)) return;
+
+    PROTOCOL_LOG(PLOG_EVENTS, ProtocolEvent::ACK_RX, myId, sender, 0, ackedSet.count());
+    emit(ackReceivedSignal, sender);
+    if (neighborTable) neighborTable->reportDiscovered(myId, sender);
+    if (coordinator) coordinator->reportProgress(myId);
+
+    // Check if we should stop sending after receiving this ACK
+    if (!stopSendingHello && isComplete()) {
+        completeProtocol();
     }
-    out += "}";
-    return out;
 }
 
-std::string HelloUdpApplication::pendingAckToString() const
+bool HelloUdpApplication::isComplete()
 {
-    // pending ACK = all IDs [0..TOTAL_VEHICLES-1] not in ackedSet
-    std::string out = "{";
-    bool first = true;
-    for (int id = 0; id < TOTAL_VEHICLES; id++) {
-        if (ackedSet.find(id) == ackedSet.end()) {
-            if (!first) out += ",";
-            out += std::to_string(id);
-            first = false;
-        }
-    }
-    out += "}";
-    return out;
+    if (!inRangeCompletion) return ackedSet.full();
+
+    // Every peer currently in range has acked; with nobody in range there is nothing to complete yet
+    neighborTable->getNeighbors(myId, expectedPeers);
+    return expectedPeers.count() > 0 && ackedSet.containsAll(expectedPeers);
 }
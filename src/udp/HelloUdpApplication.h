@@ -1,7 +1,12 @@
 #pragma once
-#include <set>
 #include <string>
 #include "veins_inet/VeinsInetApplicationBase.h"
+#include "common/LatencyHistogram.h"
+#include "common/PeerSet.h"
+
+class HelloPacket;
+class CompletionCoordinator;
+class NeighborTable;
 
 class HelloUdpApplication : public veins::VeinsInetApplicationBase
 {
@@ -12,11 +17,14 @@ class HelloUdpApplication : public veins::VeinsInetApplicationBase
   protected:
     virtual bool startApplication() override;
     virtual bool stopApplication() override;
+    virtual void finish() override;
     virtual void processPacket(std::shared_ptr<inet::Packet> pk) override;
 
   private:
     // ====== CONFIG ======
-    static constexpr int TOTAL_VEHICLES = 4;
+    int totalVehicles = 4;                        // NED parameter numVehicles
+    bool implicitAcks = false;                    // NED parameter ackMode
+    bool inRangeCompletion = false;               // NED parameter completion
     const simtime_t basePeriod = SimTime(0.1);   // 100ms
     const simtime_t jitter     = SimTime(0.005);  // 5ms
     const simtime_t initMin    = SimTime(0.05);  // 50ms
@@ -25,23 +33,51 @@ class HelloUdpApplication : public veins::VeinsInetApplicationBase
     // ====== STATE ======
     int myId = -1;
     bool stopSendingHello = false;
-    std::set<int> ackedSet;  // WHO has ACKed my HELLO messages (this is what matters!)
+    PeerSet ackedSet;  // WHO has ACKed my HELLO messages (this is what matters!)
+    PeerSet heardFrom; // WHO I have received a HELLO from (implicit ACK mode)
+    CompletionCoordinator* coordinator = nullptr;  // NED parameter coordinatorModule, may be null
+    NeighborTable* neighborTable = nullptr;        // NED parameter neighborTableModule, may be null
+    PeerSet expectedPeers;                         // in-range peers at the last completion check
 
     long helloHandle = -1;
+    long replyHandle = -1;  // pending HELLO answering peers after completion (implicit ACK mode)
+    simtime_t lastHelloSent;
 
     // ====== BENCHMARKING ======
     int helloAttempts = 0;  // Count how many HELLO messages sent
+    long helloFramesSent = 0;
+    long ackFramesSent = 0;
     simtime_t startTime;    // When did we start
     simtime_t endTime;      // When did we complete
 
+    // Send times of the last HELLOs by sequence number, to match ACKs (which echo it) for the RTT
+    static const int HELLO_HISTORY = 64;
+    struct SentHello
+    {
+        uint32_t seq = 0;
+        simtime_t time = -1;
+    };
+    SentHello sentHellos[HELLO_HISTORY];
+    PeerLatencyHistograms rttHistograms;     // HELLO sent -> its ACK received, by ACK sender
+    PeerLatencyHistograms oneWayHistograms;  // HELLO/ACK CreationTimeTag -> received, by sender
+
+    static const simsignal_t helloSentSignal;
+    static const simsignal_t helloReceivedSignal;
+    static const simsignal_t ackSentSignal;
+    static const simsignal_t ackReceivedSignal;
+    static const simsignal_t completionTimeSignal;
+    static const simsignal_t helloAttemptsSignal;
+    static const simsignal_t timedOutSignal;
+
   private:
     void scheduleHello(simtime_t delay);
     void sendHello();
-    void sendAck(int targetId);
-    void processHello(const std::string& packetName);
-    void processAck(const std::string& packetName);
-
-    int parseSenderId(const char* name) const;
-    std::string setToString(const std::set<int>& s) const;
-    std::string pendingAckToString() const;
+    void broadcastHello();
+    void scheduleReplyHello();
+    void completeProtocol();
+    void sendAck(int targetId, uint32_t seqNum);
+    void processHello(const HelloPacket& hello);
+    void processAck(const HelloPacket& ack);
+    void markAcked(int sender);
+    bool isComplete();
 };
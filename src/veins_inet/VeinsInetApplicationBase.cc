@@ -35,6 +35,7 @@
 #include "inet/networklayer/common/L3AddressResolver.h"
 #include "inet/networklayer/common/L3AddressTag_m.h"
 #include "inet/transportlayer/contract/udp/UdpControlInfo_m.h"
+#include "common/PacketTraceTag_m.h"
 
 namespace veins {
 
@@ -56,6 +57,7 @@ void VeinsInetApplicationBase::initialize(int stage)
     ApplicationBase::initialize(stage);
 
     if (stage == INITSTAGE_LOCAL) {
+        tracePackets = par("tracePackets");
     }
 }
 
@@ -186,6 +188,13 @@ void VeinsInetApplicationBase::timestampPayload(inet::Ptr<inet::Chunk> payload)
 
 void VeinsInetApplicationBase::sendPacket(std::unique_ptr<inet::Packet> pk)
 {
+    if (tracePackets) {
+        // Same id on every region of the payload, so it survives fragmentation and reassembly
+        uint64_t traceId = getSimulation()->getUniqueNumber();
+        for (auto& region : pk->addRegionTagsWhereAbsent<PacketTraceTag>(b(0), pk->getTotalLength())) {
+            region.getTag()->setTraceId(traceId);
+        }
+    }
     emit(packetSentSignal, pk.get());
     socket.sendTo(pk.release(), destAddress, portNumber);
 }
@@ -45,6 +45,7 @@ protected:
     inet::L3Address destAddress;
     const int portNumber = 9001;
     inet::UdpSocket socket;
+    bool tracePackets = false;
 
 protected:
     virtual int numInitStages() const override;
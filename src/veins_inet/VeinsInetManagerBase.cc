@@ -23,6 +23,7 @@
 #include "veins_inet/VeinsInetManagerBase.h"
 
 #include "veins/base/utils/Coord.h"
+#include "veins/modules/mobility/traci/TraCIMobility.h"
 #include "veins_inet/VeinsInetMobility.h"
 #include "inet/common/scenario/ScenarioManager.h"
 
@@ -32,6 +33,7 @@ Define_Module(veins::VeinsInetManagerBase);
 
 VeinsInetManagerBase::~VeinsInetManagerBase()
 {
+    if (timestepEndListener.manager) unsubscribe(TraCIScenarioManager::traciTimestepEndSignal, &timestepEndListener);
 }
 
 void VeinsInetManagerBase::initialize(int stage)
@@ -51,6 +53,18 @@ void VeinsInetManagerBase::initialize(int stage)
         root->emit(POST_MODEL_CHANGE, notification, NULL);
     });
 #endif
+
+    signalManager.subscribeCallback(this, TraCIScenarioManager::traciModuleRemovedSignal, [this](SignalPayload<cObject*> payload) {
+        cModule* module = dynamic_cast<cModule*>(payload.p);
+        ASSERT(module);
+        removeVehicle(module);
+    });
+
+    timestepEndListener.manager = this;
+    subscribe(TraCIScenarioManager::traciTimestepEndSignal, &timestepEndListener);
+
+    std::string traceFile = par("traceFile").stdstringValue();
+    if (!traceFile.empty()) traceWriter.open(traceFile);
 }
 
 void VeinsInetManagerBase::preInitializeModule(cModule* mod, const std::string& nodeId, const Coord& position, const std::string& road_id, double speed, Heading heading, VehicleSignalSet signals)
@@ -62,15 +76,83 @@ void VeinsInetManagerBase::preInitializeModule(cModule* mod, const std::string&
     for (auto inetmm : mobilityModules) {
         inetmm->preInitialize(nodeId, inet::Coord(position.x, position.y), road_id, speed, heading.getRad());
     }
+
+    // Resolve everything updateModulePosition needs once, instead of walking the submodules every step
+    int slot;
+    if (!freeSlots.empty()) {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    }
+    else {
+        slot = slotMobility.size();
+        slotMobility.push_back(nullptr);
+        slotHasTraCIMobility.push_back(false);
+        slotNodeId.emplace_back();
+    }
+    vehicleSlots[mod] = slot;
+    slotMobility[slot] = mobilityModules.empty() ? nullptr : mobilityModules.front();
+    slotHasTraCIMobility[slot] = !getSubmodulesOfType<TraCIMobility>(mod).empty();
+    slotNodeId[slot] = nodeId;
+
+    if (traceWriter.isOpen()) traceWriter.write(TRACE_ADD, nodeId, road_id, position.x, position.y, speed, heading.getRad());
 }
 
 void VeinsInetManagerBase::updateModulePosition(cModule* mod, const Coord& p, const std::string& edge, double speed, Heading heading, VehicleSignalSet signals)
 {
-    TraCIScenarioManager::updateModulePosition(mod, p, edge, speed, heading, signals);
+    auto it = vehicleSlots.find(mod);
+    if (it == vehicleSlots.end()) {
+        // not created through preInitializeModule
+        TraCIScenarioManager::updateModulePosition(mod, p, edge, speed, heading, signals);
+        return;
+    }
+    int slot = it->second;
 
-    // update position in VeinsInetMobility
-    auto mobilityModules = getSubmodulesOfType<VeinsInetMobility>(mod);
-    for (auto inetmm : mobilityModules) {
-        inetmm->nextPosition(inet::Coord(p.x, p.y), edge, speed, heading.getRad());
+    if (slotHasTraCIMobility[slot]) TraCIScenarioManager::updateModulePosition(mod, p, edge, speed, heading, signals);
+
+    if (slotMobility[slot]) {
+        size_t i = batch.size++;
+        if (i == batch.slot.size()) {
+            batch.slot.emplace_back();
+            batch.position.emplace_back();
+            batch.speed.emplace_back();
+            batch.heading.emplace_back();
+            batch.road.emplace_back();
+            batch.signals.push_back(signals);
+        }
+        batch.slot[i] = slot;
+        batch.position[i] = inet::Coord(p.x, p.y);
+        batch.speed[i] = speed;
+        batch.heading[i] = heading.getRad();
+        batch.road[i] = edge;
+        batch.signals[i] = signals;
+    }
+
+    if (traceWriter.isOpen()) traceWriter.write(TRACE_MOVE, slotNodeId[slot], edge, p.x, p.y, speed, heading.getRad());
+}
+
+void VeinsInetManagerBase::applyPositionUpdates()
+{
+    for (size_t i = 0; i < batch.size; i++) {
+        // vehicles removed later in the same step have a null entry
+        if (VeinsInetMobility* inetmm = slotMobility[batch.slot[i]]) {
+            inetmm->nextPosition(batch.position[i], batch.road[i], batch.speed[i], batch.heading[i], batch.signals[i]);
+        }
     }
+    batch.size = 0;
+
+    freeSlots.insert(freeSlots.end(), releasedSlots.begin(), releasedSlots.end());
+    releasedSlots.clear();
+}
+
+void VeinsInetManagerBase::removeVehicle(cModule* mod)
+{
+    auto it = vehicleSlots.find(mod);
+    if (it == vehicleSlots.end()) return;
+    int slot = it->second;
+    vehicleSlots.erase(it);
+
+    if (traceWriter.isOpen()) traceWriter.write(TRACE_REMOVE, slotNodeId[slot]);
+
+    slotMobility[slot] = nullptr;
+    releasedSlots.push_back(slot);
 }
@@ -22,13 +22,19 @@
 
 #pragma once
 
+#include <unordered_map>
+#include <vector>
+
 #include "veins_inet/veins_inet.h"
 
 #include "veins/modules/mobility/traci/TraCIScenarioManager.h"
 #include "veins/modules/utility/SignalManager.h"
+#include "veins_inet/VeinsInetTrace.h"
 
 namespace veins {
 
+class VeinsInetMobility;
+
 /**
  * @brief
  * Creates and manages network nodes corresponding to cars.
@@ -48,7 +54,46 @@ public:
     virtual void updateModulePosition(cModule* mod, const Coord& p, const std::string& edge, double speed, Heading heading, VehicleSignalSet signals) override;
 
 protected:
+    /** @brief hands the updates collected during the current TraCI step to the mobility modules */
+    virtual void applyPositionUpdates();
+
+    virtual void removeVehicle(cModule* mod);
+
+protected:
+    class TimestepEndListener : public cListener {
+    public:
+        VeinsInetManagerBase* manager = nullptr;
+        void receiveSignal(cComponent* source, simsignal_t signalID, const SimTime& t, cObject* details) override
+        {
+            manager->applyPositionUpdates();
+        }
+    };
+
     SignalManager signalManager;
+    TimestepEndListener timestepEndListener;
+
+    /** @brief records vehicle insertions, moves and removals if parameter traceFile is set */
+    VeinsInetTraceWriter traceWriter;
+
+    // Per-vehicle lookups resolved once in preInitializeModule, indexed by slot
+    std::unordered_map<cModule*, int> vehicleSlots;
+    std::vector<VeinsInetMobility*> slotMobility; /**< nullptr once the vehicle is gone */
+    std::vector<bool> slotHasTraCIMobility; /**< host also has Veins TraCIMobility submodules */
+    std::vector<std::string> slotNodeId;
+    std::vector<int> freeSlots;
+    std::vector<int> releasedSlots; /**< freed during the current step, reusable after the batch is applied */
+
+    // Updates of the current step, one entry per vehicle, applied in a single pass at traciTimestepEndSignal.
+    // Entries are overwritten in place so their storage (incl. road strings) is reused between steps.
+    struct PositionBatch {
+        size_t size = 0;
+        std::vector<int> slot;
+        std::vector<inet::Coord> position;
+        std::vector<double> speed;
+        std::vector<double> heading;
+        std::vector<std::string> road;
+        std::vector<VehicleSignalSet> signals;
+    } batch;
 };
 
 class VEINS_INET_API VeinsInetManagerBaseAccess {
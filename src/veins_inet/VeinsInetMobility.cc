@@ -27,6 +27,8 @@
 
 #include "veins_inet/VeinsInetMobility.h"
 
+#include <cstring>
+
 #include "inet/common/INETMath.h"
 #include "inet/common/Units.h"
 #include "inet/common/geometry/common/GeographicCoordinateSystem.h"
@@ -37,6 +39,8 @@ using namespace inet::units::values;
 
 Register_Class(VeinsInetMobility);
 
+const simsignal_t VeinsInetMobility::vehicleStateChangedSignal = registerSignal("vehicleStateChanged");
+
 VeinsInetMobility::VeinsInetMobility()
 {
 }
@@ -53,6 +57,11 @@ void VeinsInetMobility::preInitialize(std::string external_id, const inet::Coord
     lastPosition = position;
     lastVelocity = inet::Coord(cos(angle), -sin(angle)) * speed;
     lastOrientation = inet::Quaternion(inet::EulerAngles(rad(-angle), rad(0.0), rad(0.0)));
+
+    vehicleState.roadId = road_id;
+    vehicleState.speed = speed;
+    vehicleState.heading = angle;
+    vehicleState.lastUpdate = simTime();
 }
 
 void VeinsInetMobility::initialize(int stage)
@@ -63,23 +72,33 @@ void VeinsInetMobility::initialize(int stage)
     ASSERT(hasPar("initFromDisplayString") && par("initFromDisplayString"));
 }
 
-void VeinsInetMobility::nextPosition(const inet::Coord& position, std::string road_id, double speed, double angle)
+void VeinsInetMobility::nextPosition(const inet::Coord& position, const std::string& road_id, double speed, double angle, VehicleSignalSet signals)
 {
     Enter_Method_Silent();
 
+    bool roadChanged = vehicleState.roadId != road_id;
+    if (roadChanged) vehicleState.roadId = road_id;
+    vehicleState.speed = speed;
+    vehicleState.heading = angle;
+    vehicleState.signals = signals;
+    vehicleState.lastUpdate = simTime();
+
     lastPosition = position;
     lastVelocity = inet::Coord(cos(angle), -sin(angle)) * speed;
     lastOrientation = inet::Quaternion(inet::EulerAngles(rad(-angle), rad(0.0), rad(0.0)));
 
-    // Update display string to show node is getting updates
-    auto hostMod = getParentModule();
-    if (std::string(hostMod->getDisplayString().getTagArg("veins", 0)) == ". ") {
-        hostMod->getDisplayString().setTagArg("veins", 0, " .");
-    }
-    else {
-        hostMod->getDisplayString().setTagArg("veins", 0, ". ");
+    // Update display string to show node is getting updates (nobody sees it in Cmdenv)
+    if (hasGUI()) {
+        auto hostMod = getParentModule();
+        if (strcmp(hostMod->getDisplayString().getTagArg("veins", 0), ". ") == 0) {
+            hostMod->getDisplayString().setTagArg("veins", 0, " .");
+        }
+        else {
+            hostMod->getDisplayString().setTagArg("veins", 0, ". ");
+        }
     }
 
+    if (roadChanged) emit(vehicleStateChangedSignal, this);
     emitMobilityStateChangedSignal();
 }
 
@@ -170,13 +189,14 @@ TraCIScenarioManager* VeinsInetMobility::getManager() const
 
 TraCICommandInterface* VeinsInetMobility::getCommandInterface() const
 {
-    if (!commandInterface) commandInterface = getManager()->getCommandInterface();
+    // No TraCI manager when positions come from VeinsInetReplayManager
+    if (!commandInterface && getManager()) commandInterface = getManager()->getCommandInterface();
     return commandInterface;
 }
 
 TraCICommandInterface::Vehicle* VeinsInetMobility::getVehicleCommandInterface() const
 {
-    if (!vehicleCommandInterface) vehicleCommandInterface = new TraCICommandInterface::Vehicle(getCommandInterface()->vehicle(getExternalId()));
+    if (!vehicleCommandInterface && getCommandInterface()) vehicleCommandInterface = new TraCICommandInterface::Vehicle(getCommandInterface()->vehicle(getExternalId()));
     return vehicleCommandInterface;
 }
 
@@ -40,6 +40,15 @@ using namespace omnetpp;
 
 namespace veins {
 
+/** @brief Vehicle attributes of the latest TraCI step, cached so apps do not have to query SUMO for them */
+struct VEINS_INET_API VeinsInetVehicleState {
+    std::string roadId;
+    double speed = 0;
+    double heading = 0; /**< rad, as passed by the manager */
+    VehicleSignalSet signals = {VehicleSignal::undefined};
+    simtime_t lastUpdate;
+};
+
 class VEINS_INET_API VeinsInetMobility : public inet::MobilityBase {
 public:
     VeinsInetMobility();
@@ -52,7 +61,16 @@ public:
     virtual void initialize(int stage) override;
 
     /** @brief called by class VeinsInetManager */
-    virtual void nextPosition(const inet::Coord& position, std::string road_id, double speed, double angle);
+    virtual void nextPosition(const inet::Coord& position, const std::string& road_id, double speed, double angle, VehicleSignalSet signals = {VehicleSignal::undefined});
+
+    /** @brief attributes of the latest update, no TraCI round trip */
+    const VeinsInetVehicleState& getVehicleState() const
+    {
+        return vehicleState;
+    }
+
+    /** @brief emitted with this module as payload when the vehicle moves to another road */
+    static const simsignal_t vehicleStateChangedSignal;
 
 #if INET_VERSION >= 0x0403
     virtual const inet::Coord& getCurrentPosition() override;
@@ -73,6 +91,7 @@ public:
 #endif
 
     virtual std::string getExternalId() const;
+    /** @brief nullptr (as are the command interfaces) when the vehicle is driven by VeinsInetReplayManager */
     virtual TraCIScenarioManager* getManager() const;
     virtual TraCICommandInterface* getCommandInterface() const;
     virtual TraCICommandInterface::Vehicle* getVehicleCommandInterface() const;
@@ -90,6 +109,8 @@ protected:
 
     std::string external_id; /**< identifier used by TraCI server to refer to this node */
 
+    VeinsInetVehicleState vehicleState;
+
 protected:
     virtual void setInitialPosition() override;
 
@@ -0,0 +1,132 @@
+//
+// Documentation for these modules is at http://veins.car2x.org/
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+
+#include "veins_inet/VeinsInetReplayManager.h"
+
+#include "veins_inet/VeinsInetMobility.h"
+#include "inet/common/scenario/ScenarioManager.h"
+
+using veins::VeinsInetReplayManager;
+
+Define_Module(veins::VeinsInetReplayManager);
+
+VeinsInetReplayManager::~VeinsInetReplayManager()
+{
+    cancelAndDelete(stepMsg);
+}
+
+void VeinsInetReplayManager::initialize(int stage)
+{
+    if (stage != 1)
+        return;
+
+    moduleType = par("moduleType").stdstringValue();
+    moduleName = par("moduleName").stdstringValue();
+    moduleDisplayString = par("moduleDisplayString").stdstringValue();
+
+    reader.open(par("traceFile").stdstringValue());
+
+    stepMsg = new cMessage("replayStep");
+    if (const VeinsInetTraceRecord* record = reader.peek()) {
+        scheduleAt(SimTime().setRaw(record->time), stepMsg);
+    }
+}
+
+void VeinsInetReplayManager::handleMessage(cMessage* msg)
+{
+    if (msg != stepMsg) throw cRuntimeError("VeinsInetReplayManager received unknown message '%s'", msg->getName());
+
+    // Apply every record of this time step, then sleep until the next one
+    int64_t now = simTime().raw();
+    const VeinsInetTraceRecord* record;
+    while ((record = reader.peek()) && record->time <= now) {
+        if (record->node >= hosts.size()) {
+            hosts.resize(reader.getNumStrings(), nullptr);
+            mobilities.resize(reader.getNumStrings(), nullptr);
+        }
+
+        switch (record->kind) {
+        case TRACE_ADD:
+            if (hosts[record->node]) throw cRuntimeError("Trace adds vehicle '%s' twice", reader.getString(record->node).c_str());
+            hosts[record->node] = addModule(*record);
+            break;
+        case TRACE_MOVE:
+            if (VeinsInetMobility* inetmm = mobilities[record->node]) inetmm->nextPosition(inet::Coord(record->x, record->y), reader.getString(record->road), record->speed, record->heading);
+            break;
+        case TRACE_REMOVE:
+            deleteModule(record->node);
+            break;
+        default:
+            throw cRuntimeError("Unknown trace record kind %d", record->kind);
+        }
+        reader.next();
+    }
+
+    if (record) scheduleAt(SimTime().setRaw(record->time), stepMsg);
+}
+
+void VeinsInetReplayManager::finish()
+{
+    reader.close();
+}
+
+cModule* VeinsInetReplayManager::addModule(const VeinsInetTraceRecord& record)
+{
+    // Same steps as TraCIScenarioManager::addModule
+    cModuleType* nodeType = cModuleType::get(moduleType.c_str());
+    if (!nodeType) throw cRuntimeError("Module Type \"%s\" not found", moduleType.c_str());
+
+    cModule* parentmod = getParentModule();
+    int32_t nodeVectorIndex = nextNodeVectorIndex++;
+    cModule* mod = nodeType->create(moduleName.c_str(), parentmod, nodeVectorIndex, nodeVectorIndex);
+    mod->finalizeParameters();
+    if (!moduleDisplayString.empty()) mod->getDisplayString().parse(moduleDisplayString.c_str());
+    mod->buildInside();
+    mod->scheduleStart(simTime());
+
+    const std::string& nodeId = reader.getString(record.node);
+    const std::string& roadId = reader.getString(record.road);
+    auto mobilityModules = getSubmodulesOfType<VeinsInetMobility>(mod);
+    for (auto inetmm : mobilityModules) {
+        inetmm->preInitialize(nodeId, inet::Coord(record.x, record.y), roadId, record.speed, record.heading);
+    }
+    mobilities[record.node] = mobilityModules.empty() ? nullptr : mobilityModules.front();
+
+#if INET_VERSION >= 0x0402
+    // What VeinsInetManagerBase does on traciModulePreInitSignal
+    inet::cPreModuleInitNotification notification;
+    notification.module = mod;
+    getSimulation()->getSystemModule()->emit(POST_MODEL_CHANGE, &notification, nullptr);
+#endif
+
+    mod->callInitialize();
+    return mod;
+}
+
+void VeinsInetReplayManager::deleteModule(uint32_t node)
+{
+    cModule* mod = hosts[node];
+    if (!mod) return;
+    hosts[node] = nullptr;
+    mobilities[node] = nullptr;
+
+    mod->callFinish();
+    mod->deleteModule();
+}
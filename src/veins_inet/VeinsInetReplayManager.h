@@ -0,0 +1,68 @@
+//
+// Documentation for these modules is at http://veins.car2x.org/
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+
+#pragma once
+
+#include <vector>
+
+#include "veins_inet/veins_inet.h"
+#include "veins_inet/VeinsInetTrace.h"
+
+namespace veins {
+
+class VeinsInetMobility;
+
+/**
+ * Creates, moves and deletes vehicle modules from a mobility trace recorded by
+ * VeinsInetManagerBase (parameter traceFile), without a SUMO connection.
+ *
+ * Vehicles get the same module indices and positions as in the recorded run.
+ * There is no TraCI command interface: VeinsInetMobility::getCommandInterface()
+ * returns nullptr, and commands sent to SUMO in the recorded run (e.g. setSpeed)
+ * are only reproduced through the recorded positions.
+ */
+class VEINS_INET_API VeinsInetReplayManager : public cSimpleModule {
+public:
+    virtual ~VeinsInetReplayManager();
+
+    int numInitStages() const override
+    {
+        return 2;
+    }
+    void initialize(int stage) override;
+    void handleMessage(cMessage* msg) override;
+    void finish() override;
+
+protected:
+    cModule* addModule(const VeinsInetTraceRecord& record);
+    void deleteModule(uint32_t node);
+
+    std::string moduleType;
+    std::string moduleName;
+    std::string moduleDisplayString;
+
+    VeinsInetTraceReader reader;
+    std::vector<cModule*> hosts; // indexed by the string id of the vehicle
+    std::vector<VeinsInetMobility*> mobilities; // same index, resolved once in addModule
+    int32_t nextNodeVectorIndex = 0;
+    cMessage* stepMsg = nullptr;
+};
+
+} // namespace veins
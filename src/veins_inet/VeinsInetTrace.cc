@@ -0,0 +1,181 @@
+//
+// Documentation for these modules is at http://veins.car2x.org/
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+
+#include "veins_inet/VeinsInetTrace.h"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using veins::VeinsInetTraceReader;
+using veins::VeinsInetTraceRecord;
+using veins::VeinsInetTraceWriter;
+
+namespace {
+
+size_t paddedLength(size_t length)
+{
+    return (length + 7) & ~size_t(7);
+}
+
+} // namespace
+
+VeinsInetTraceWriter::~VeinsInetTraceWriter()
+{
+    close();
+}
+
+void VeinsInetTraceWriter::open(const std::string& fileName)
+{
+    close();
+    out = fopen(fileName.c_str(), "wb");
+    if (!out) throw cRuntimeError("Cannot open trace file '%s' for writing", fileName.c_str());
+
+    // One position update per vehicle per step: write in large blocks
+    outBuffer.resize(1 << 20);
+    setvbuf(out, outBuffer.data(), _IOFBF, outBuffer.size());
+
+    VeinsInetTraceHeader header = {};
+    memcpy(header.magic, "VITR", 4);
+    header.version = VEINS_INET_TRACE_VERSION;
+    header.simtimeScaleExp = SimTime::getScaleExp();
+    fwrite(&header, sizeof(header), 1, out);
+}
+
+void VeinsInetTraceWriter::close()
+{
+    if (out) fclose(out);
+    out = nullptr;
+    strings.clear();
+}
+
+uint32_t VeinsInetTraceWriter::intern(const std::string& s)
+{
+    auto it = strings.find(s);
+    if (it != strings.end()) return it->second;
+
+    uint32_t id = strings.size();
+    strings[s] = id;
+
+    VeinsInetTraceRecord record = {};
+    record.kind = TRACE_STRING;
+    record.node = id;
+    record.road = s.size();
+    fwrite(&record, sizeof(record), 1, out);
+
+    static const char zeros[8] = {};
+    fwrite(s.data(), 1, s.size(), out);
+    fwrite(zeros, 1, paddedLength(s.size()) - s.size(), out);
+    return id;
+}
+
+void VeinsInetTraceWriter::write(VeinsInetTraceRecordKind kind, const std::string& nodeId, const std::string& road, double x, double y, double speed, double heading)
+{
+    ASSERT(out);
+
+    VeinsInetTraceRecord record = {};
+    record.kind = kind;
+    record.node = intern(nodeId);
+    record.road = intern(road);
+    record.time = simTime().raw();
+    record.x = x;
+    record.y = y;
+    record.speed = speed;
+    record.heading = heading;
+    fwrite(&record, sizeof(record), 1, out);
+}
+
+VeinsInetTraceReader::~VeinsInetTraceReader()
+{
+    close();
+}
+
+void VeinsInetTraceReader::open(const std::string& fileName)
+{
+    close();
+
+#ifndef _WIN32
+    int fd = ::open(fileName.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                madvise(p, st.st_size, MADV_SEQUENTIAL);
+                data = static_cast<const char*>(p);
+                size = st.st_size;
+                mapped = true;
+            }
+        }
+        ::close(fd);
+    }
+#endif
+
+    if (!data) {
+        std::ifstream in(fileName, std::ios::binary);
+        if (!in) throw cRuntimeError("Cannot open trace file '%s'", fileName.c_str());
+        contents.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        data = contents.data();
+        size = contents.size();
+    }
+
+    VeinsInetTraceHeader header;
+    if (size < sizeof(header)) throw cRuntimeError("Trace file '%s' is truncated", fileName.c_str());
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, "VITR", 4) != 0 || header.version != VEINS_INET_TRACE_VERSION) throw cRuntimeError("'%s' is not a version %u mobility trace", fileName.c_str(), VEINS_INET_TRACE_VERSION);
+    if (header.simtimeScaleExp != SimTime::getScaleExp()) throw cRuntimeError("Trace file '%s' was recorded with simtime-scale %d, this run uses %d", fileName.c_str(), header.simtimeScaleExp, SimTime::getScaleExp());
+    pos = sizeof(header);
+}
+
+void VeinsInetTraceReader::close()
+{
+#ifndef _WIN32
+    if (mapped) munmap(const_cast<char*>(data), size);
+#endif
+    data = nullptr;
+    size = 0;
+    pos = 0;
+    mapped = false;
+    contents.clear();
+    strings.clear();
+}
+
+const VeinsInetTraceRecord* VeinsInetTraceReader::peek()
+{
+    while (pos + sizeof(VeinsInetTraceRecord) <= size) {
+        // Records are 8-byte multiples from an 8-byte aligned start, so they can be read in place
+        auto record = reinterpret_cast<const VeinsInetTraceRecord*>(data + pos);
+        if (record->kind != TRACE_STRING) return record;
+
+        size_t length = record->road;
+        const char* text = data + pos + sizeof(VeinsInetTraceRecord);
+        if (record->node != strings.size() || text + length > data + size) throw cRuntimeError("Corrupt mobility trace at offset %zu", pos);
+        strings.emplace_back(text, length);
+        pos += sizeof(VeinsInetTraceRecord) + paddedLength(length);
+    }
+    return nullptr;
+}
@@ -0,0 +1,127 @@
+//
+// Documentation for these modules is at http://veins.car2x.org/
+//
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "veins_inet/veins_inet.h"
+
+namespace veins {
+
+/**
+ * Binary mobility trace written by VeinsInetManagerBase (parameter traceFile) and
+ * replayed by VeinsInetReplayManager.
+ *
+ * Layout: one VeinsInetTraceHeader, then VeinsInetTraceRecords in simulation time order.
+ * Vehicle and road ids are interned: a TRACE_STRING record (node = string id,
+ * road = length) is followed by the string bytes, padded to a multiple of 8, and
+ * precedes the first record that refers to it. All fields are host byte order.
+ */
+struct VeinsInetTraceHeader {
+    char magic[4]; // "VITR"
+    uint32_t version;
+    int32_t simtimeScaleExp; // times are raw simtime values at this scale
+    uint32_t reserved;
+};
+
+enum VeinsInetTraceRecordKind : uint16_t {
+    TRACE_STRING = 1,
+    TRACE_ADD = 2, // preInitializeModule
+    TRACE_MOVE = 3, // updateModulePosition
+    TRACE_REMOVE = 4 // vehicle left the simulation
+};
+
+struct VeinsInetTraceRecord {
+    uint16_t kind;
+    uint16_t reserved;
+    uint32_t node; // string id of the vehicle
+    uint32_t road; // string id of the road
+    uint32_t reserved2;
+    int64_t time; // raw simtime
+    double x;
+    double y;
+    double speed;
+    double heading; // rad
+};
+
+static_assert(sizeof(VeinsInetTraceRecord) == 56, "VeinsInetTraceRecord must be packed to 56 bytes");
+
+const uint32_t VEINS_INET_TRACE_VERSION = 1;
+
+class VEINS_INET_API VeinsInetTraceWriter {
+public:
+    ~VeinsInetTraceWriter();
+
+    void open(const std::string& fileName);
+    bool isOpen() const
+    {
+        return out != nullptr;
+    }
+    void close();
+
+    void write(VeinsInetTraceRecordKind kind, const std::string& nodeId, const std::string& road = "", double x = 0, double y = 0, double speed = 0, double heading = 0);
+
+protected:
+    uint32_t intern(const std::string& s);
+
+    FILE* out = nullptr;
+    std::vector<char> outBuffer;
+    std::unordered_map<std::string, uint32_t> strings;
+};
+
+class VEINS_INET_API VeinsInetTraceReader {
+public:
+    ~VeinsInetTraceReader();
+
+    /** @brief memory-maps the file (reads it into memory where mmap is not available) */
+    void open(const std::string& fileName);
+    void close();
+
+    /** @brief next ADD/MOVE/REMOVE record, or nullptr at the end of the trace; interns strings on the way */
+    const VeinsInetTraceRecord* peek();
+    void next()
+    {
+        pos += sizeof(VeinsInetTraceRecord);
+    }
+
+    const std::string& getString(uint32_t id) const
+    {
+        return strings.at(id);
+    }
+    size_t getNumStrings() const
+    {
+        return strings.size();
+    }
+
+protected:
+    const char* data = nullptr;
+    size_t size = 0;
+    size_t pos = 0;
+    bool mapped = false;
+    std::vector<char> contents; // used when the file could not be mapped
+    std::vector<std::string> strings;
+};
+
+} // namespace veins
@@ -0,0 +1,79 @@
+#include "wave/DccController.h"
+
+#include <algorithm>
+
+namespace {
+
+// Reactive states: CBR at or above which the state is left upwards, HELLO interval as a
+// multiple of minInterval, and TX power as a fraction of the configured power
+const int NUM_STATES = 5;
+const double STATE_CBR[NUM_STATES] = {0.30, 0.40, 0.50, 0.65, 1.01};
+const double STATE_INTERVAL[NUM_STATES] = {1, 2, 4, 5, 10};
+const double STATE_POWER[NUM_STATES] = {1, 1, 0.5, 0.25, 0.1};
+
+// LIMERIC gains and duty cycle bounds
+const double LIMERIC_ALPHA = 0.016;
+const double LIMERIC_BETA = 0.0012;
+const double LIMERIC_DELTA_MIN = 0.0006;
+const double LIMERIC_DELTA_MAX = 0.03;
+
+} // namespace
+
+DccController::DccController(Algorithm algorithm, simtime_t minInterval, simtime_t maxInterval, double cbrTarget, simtime_t frameDuration)
+    : algorithm(algorithm), minInterval(minInterval), maxInterval(maxInterval), cbrTarget(cbrTarget), frameDuration(frameDuration)
+{
+    windowStart = simTime();
+    busyTime = SIMTIME_ZERO;
+    interval = minInterval;
+    dutyCycle = frameDuration / minInterval;
+}
+
+void DccController::receiveSignal(cComponent *source, simsignal_t signalID, bool b, cObject *details)
+{
+    if (b) {
+        if (busySince < SIMTIME_ZERO) busySince = simTime();
+    }
+    else if (busySince >= SIMTIME_ZERO) {
+        busyTime += simTime() - busySince;
+        busySince = -1;
+    }
+}
+
+double DccController::update()
+{
+    simtime_t now = simTime();
+    simtime_t busy = busyTime;
+    if (busySince >= SIMTIME_ZERO) {
+        // Still busy: count up to now, the rest goes to the next window
+        busy += now - busySince;
+        busySince = now;
+    }
+
+    double cbr = now > windowStart ? std::min(1.0, busy / (now - windowStart)) : 0.0;
+    windowStart = now;
+    busyTime = SIMTIME_ZERO;
+
+    if (algorithm == REACTIVE) updateReactive(cbr);
+    else updateAdaptive(cbr);
+    return cbr;
+}
+
+void DccController::updateReactive(double cbr)
+{
+    // One step at a time, so a single busy interval does not jump straight to Restrictive
+    if (cbr >= STATE_CBR[state] && state < NUM_STATES - 1) state++;
+    else if (state > 0 && cbr < STATE_CBR[state - 1]) state--;
+
+    interval = std::min(minInterval * STATE_INTERVAL[state], maxInterval);
+    powerFactor = STATE_POWER[state];
+}
+
+void DccController::updateAdaptive(double cbr)
+{
+    // delta <- (1 - alpha) delta + beta (target - cbr), then clamped
+    dutyCycle = (1 - LIMERIC_ALPHA) * dutyCycle + LIMERIC_BETA * (cbrTarget - cbr);
+    dutyCycle = std::max(LIMERIC_DELTA_MIN, std::min(LIMERIC_DELTA_MAX, dutyCycle));
+
+    interval = std::max(minInterval, std::min(maxInterval, frameDuration / dutyCycle));
+    powerFactor = 1;
+}
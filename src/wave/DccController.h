@@ -0,0 +1,57 @@
+#pragma once
+#include <omnetpp.h>
+
+using namespace omnetpp;
+
+// Decentralized congestion control for the HELLO rate, driven by the channel
+// busy ratio (CBR) the 1609.4 MAC reports through sigChannelBusy.
+//
+// The owner subscribes the controller to "org_car2x_veins_modules_mac_sigChannelBusy"
+// on the host and calls update() once per measurement interval. update() closes the
+// interval, returns its CBR and picks the HELLO interval (and TX power factor) for
+// the next one:
+//   REACTIVE  state machine after ETSI TS 102 687: Relaxed / Active 1-3 / Restrictive,
+//             at most one state per update
+//   ADAPTIVE  LIMERIC linear control of the duty cycle towards cbrTarget
+//             (gains and duty cycle bounds of ETSI TS 102 687 V1.2.1)
+class DccController : public cListener
+{
+  public:
+    enum Algorithm
+    {
+        REACTIVE,
+        ADAPTIVE
+    };
+
+    DccController(Algorithm algorithm, simtime_t minInterval, simtime_t maxInterval, double cbrTarget, simtime_t frameDuration);
+
+    double update();
+
+    simtime_t getInterval() const { return interval; }
+    double getPowerFactor() const { return powerFactor; }
+    int getState() const { return state; }
+
+  protected:
+    virtual void receiveSignal(cComponent *source, simsignal_t signalID, bool b, cObject *details) override;
+
+  private:
+    // ====== CONFIG ======
+    Algorithm algorithm;
+    simtime_t minInterval;
+    simtime_t maxInterval;
+    double cbrTarget;
+    simtime_t frameDuration;  // air time of one HELLO, converts between duty cycle and interval
+
+    // ====== STATE ======
+    simtime_t windowStart;
+    simtime_t busyTime;       // accumulated in the current window
+    simtime_t busySince = -1; // -1 while idle
+    int state = 0;            // REACTIVE: 0 Relaxed .. 4 Restrictive
+    double dutyCycle = 0;     // ADAPTIVE
+    simtime_t interval;
+    double powerFactor = 1;
+
+  private:
+    void updateReactive(double cbr);
+    void updateAdaptive(double cbr);
+};
@@ -1,35 +1,101 @@
 #include "HelloWaveApplication.h"
-#include <iostream>
+#include <algorithm>
+#include "inet/common/ModuleAccess.h"
+#include "wave/HelloWaveMessage_m.h"
+#include "veins/modules/mac/ieee80211p/Mac1609_4.h"
+#include "common/CompletionCoordinator.h"
+#include "common/NeighborTable.h"
+#include "common/ProtocolLog.h"
 
 Define_Module(HelloWaveApplication);
 
+const simsignal_t HelloWaveApplication::helloSentSignal = registerSignal("helloSent");
+const simsignal_t HelloWaveApplication::helloReceivedSignal = registerSignal("helloReceived");
+const simsignal_t HelloWaveApplication::ackSentSignal = registerSignal("ackSent");
+const simsignal_t HelloWaveApplication::ackReceivedSignal = registerSignal("ackReceived");
+const simsignal_t HelloWaveApplication::ackTargetsSignal = registerSignal("ackTargets");
+const simsignal_t HelloWaveApplication::channelBusyRatioSignal = registerSignal("channelBusyRatio");
+const simsignal_t HelloWaveApplication::helloIntervalSignal = registerSignal("helloInterval");
+const simsignal_t HelloWaveApplication::completionTimeSignal = registerSignal("completionTime");
+const simsignal_t HelloWaveApplication::helloAttemptsSignal = registerSignal("helloAttempts");
+const simsignal_t HelloWaveApplication::timedOutSignal = registerSignal("timedOut");
+
 void HelloWaveApplication::initialize(int stage)
 {
     DemoBaseApplLayer::initialize(stage);
 
     if (stage == 0) {
         myId = getParentModule()->getIndex();
+        totalVehicles = par("numVehicles");
+
+        std::string ackMode = par("ackMode").stdstringValue();
+        implicitAcks = ackMode == "implicit";
+        aggregatedAcks = ackMode == "aggregated";
+        if (!implicitAcks && !aggregatedAcks && ackMode != "explicit") throw cRuntimeError("Unknown ackMode '%s'", ackMode.c_str());
+        maxAckTargets = par("maxAckTargets");
+        if (maxAckTargets < 1) throw cRuntimeError("maxAckTargets must be at least 1");
 
         helloEvent = new cMessage("helloTimer");
+        ackBatchEvent = new cMessage("ackBatchTimer");
+        pendingAckTargets.clear();
 
-        ackedSet.clear();
+        ackedSet.reset(totalVehicles);
         ackedSet.insert(myId);
-        ackSentTo.clear();
+        ackSentTo.reset(totalVehicles);
+        ackSeq.assign(totalVehicles, 0);
+        heardFrom.reset(totalVehicles);
+
+        std::string completion = par("completion").stdstringValue();
+        if (completion == "fleet") inRangeCompletion = false;
+        else if (completion == "inRange") inRangeCompletion = true;
+        else throw cRuntimeError("Unknown completion '%s'", completion.c_str());
+
+        neighborTable = inet::findModuleFromPar<NeighborTable>(par("neighborTableModule"), this);
+        if (inRangeCompletion && !neighborTable) throw cRuntimeError("completion=\"inRange\" needs a NeighborTable (neighborTableModule)");
+        expectedPeers.reset(totalVehicles);
+
+        coordinator = inet::findModuleFromPar<CompletionCoordinator>(par("coordinatorModule"), this);
+
+        // Congestion control: the MAC reports busy/idle of the channel as a signal, which reaches the host
+        std::string dccMode = par("dcc").stdstringValue();
+        if (dccMode != "off") {
+            DccController::Algorithm algorithm;
+            if (dccMode == "reactive") algorithm = DccController::REACTIVE;
+            else if (dccMode == "adaptive") algorithm = DccController::ADAPTIVE;
+            else throw cRuntimeError("Unknown dcc '%s'", dccMode.c_str());
+
+            dccInterval = par("dccInterval");
+            dccTxPower = par("dccTxPower");
+            dcc = new DccController(algorithm, basePeriod, par("maxHelloInterval").doubleValue(), par("cbrTarget").doubleValue(), par("helloFrameDuration").doubleValue());
+            getParentModule()->subscribe("org_car2x_veins_modules_mac_sigChannelBusy", dcc);
+            dccEvent = new cMessage("dccTimer");
+            scheduleAt(simTime() + dccInterval, dccEvent);
+
+            if (dccTxPower) {
+                mac1609 = FindModule<Mac1609_4*>::findSubModule(getParentModule());
+                if (!mac1609) throw cRuntimeError("dccTxPower needs a Mac1609_4 in the host");
+                maxTxPower = mac1609->par("txPower");
+            }
+        }
 
         // clear & cleanup in case
-        for (auto& kv : ackTimers) { cancelAndDelete(kv.second); }
+        for (cMessage* t : ackTimers) { cancelAndDelete(t); }
         ackTimers.clear();
+        freeAckTimers.clear();
 
         stopSendingHello = false;
 
         helloAttempts = 0;
+        helloFramesSent = 0;
+        ackFramesSent = 0;
         startTime = simTime();
         endTime = -1;
+        for (SentHello& h : sentHellos) h = SentHello();
+        rttHistograms.reset(totalVehicles);
+        oneWayHistograms.reset(totalVehicles);
 
-        // Keep init logs in EV only
         EV << simTime() << " V" << myId
-           << " init acked=" << setToString(ackedSet)
-           << " pending=" << pendingAckToString() << "\n";
+           << " init fleet=" << totalVehicles << "\n";
     }
 }
 
@@ -40,6 +106,8 @@ void HelloWaveApplication::handlePositionUpdate(cObject* obj)
     if (!helloEvent->isScheduled() && !stopSendingHello) {
         simtime_t delay = uniform(initMin, initMax);
         scheduleHello(delay);
+        if (coordinator) coordinator->reportStarted(myId);
+        if (neighborTable) neighborTable->registerVehicle(myId, mobility);
 
         EV << simTime() << " V" << myId
            << " first pos update -> schedule HELLO in " << delay << "s\n";
@@ -49,14 +117,22 @@ void HelloWaveApplication::handlePositionUpdate(cObject* obj)
 void HelloWaveApplication::handleSelfMsg(cMessage* msg)
 {
     if (msg == helloEvent) {
+        if (stopSendingHello) {
+            // Implicit ACK mode: one-off HELLO answering peers that are still handshaking
+            broadcastHello();
+            return;
+        }
+
         sendHello();
 
         if (!stopSendingHello) {
-            int missing = TOTAL_VEHICLES - (int)ackedSet.size();
+            int missing = ackedSet.missing();
 
-            // Adaptive period to reduce congestion when only a few ACKs are missing
+            // Period from the congestion controller if there is one, otherwise
+            // slow down when only a few ACKs are missing
             simtime_t period = basePeriod;
-            if (missing == 1) period = SimTime(0.5);   // slow down a lot
+            if (dcc) period = dcc->getInterval();
+            else if (missing == 1) period = SimTime(0.5);   // slow down a lot
             else if (missing == 2) period = SimTime(0.2);
 
             simtime_t nextDelay = period + uniform(-jitter, jitter);
@@ -69,17 +145,23 @@ void HelloWaveApplication::handleSelfMsg(cMessage* msg)
         return;
     }
 
-    // Handle delayed ACK timers
-    for (auto it = ackTimers.begin(); it != ackTimers.end(); ++it) {
-        if (it->second == msg) {
-            int targetId = it->first;  // senderId of the HELLO we are ACKing
+    if (msg == dccEvent) {
+        updateDcc();
+        scheduleAt(simTime() + dccInterval, dccEvent);
+        return;
+    }
 
-            sendAck(targetId);
+    if (msg == ackBatchEvent) {
+        sendAggregatedAck();
+        return;
+    }
 
-            delete msg;
-            ackTimers.erase(it);
-            return;
-        }
+    // Handle delayed ACK timers
+    if (msg->getKind() == ACK_TIMER_KIND) {
+        int targetId = (int)(intptr_t)msg->getContextPointer();  // senderId of the HELLO we are ACKing
+        freeAckTimers.push_back(msg);
+        sendAck(targetId);
+        return;
     }
 
     DemoBaseApplLayer::handleSelfMsg(msg);
@@ -87,13 +169,18 @@ void HelloWaveApplication::handleSelfMsg(cMessage* msg)
 
 void HelloWaveApplication::onWSM(BaseFrame1609_4* wsm)
 {
-    std::string msgName = wsm->getName();
-
-    if (msgName.rfind("HELLO", 0) == 0) {
-        processHello(wsm);
-    }
-    else if (msgName.rfind("ACK", 0) == 0) {
-        processAck(wsm);
+    HelloWaveMessage* msg = dynamic_cast<HelloWaveMessage*>(wsm);
+    if (!msg) return;
+
+    oneWayHistograms.record(msg->getSenderId(), simTime() - msg->getCreationTime());
+
+    switch (msg->getType()) {
+        case HELLO_MSG_HELLO:
+            processHello(msg);
+            break;
+        case HELLO_MSG_ACK:
+            processAck(msg);
+            break;
     }
 }
 
@@ -107,203 +194,285 @@ void HelloWaveApplication::sendHello()
     if (stopSendingHello) return;
 
     // Stop condition (everyone acked me)
-    if ((int)ackedSet.size() >= TOTAL_VEHICLES) {
-        stopSendingHello = true;
-        if (helloEvent->isScheduled()) cancelEvent(helloEvent);
-
-        endTime = simTime();
-        double duration = (endTime - startTime).dbl();
-
-        // CLEAN stdout: only completion
-        std::cout << simTime() << " V" << myId
-                  << " COMPLETED attempts=" << helloAttempts
-                  << " duration=" << duration << "s"
-                  << " acked=" << ackedSet.size() << "/" << TOTAL_VEHICLES
-                  << std::endl;
+    if (isComplete()) {
+        completeProtocol();
         return;
     }
 
     helloAttempts++;
 
-    std::string msgName = "HELLO_from_" + std::to_string(myId);
+    broadcastHello();
+
+    PROTOCOL_LOG(PLOG_EVENTS, ProtocolEvent::HELLO_TX, myId, -1, helloAttempts, ackedSet.count());
+}
 
-    BaseFrame1609_4* wsm = new BaseFrame1609_4(msgName.c_str());
+void HelloWaveApplication::broadcastHello()
+{
+    HelloWaveMessage* wsm = new HelloWaveMessage("HELLO");
     populateWSM(wsm);
+    wsm->addByteLength(HELLO_PACKET_BYTES);
+    wsm->setType(HELLO_MSG_HELLO);
+    wsm->setSenderId(myId);
+    wsm->setSequenceNumber(helloAttempts);
+    wsm->setCreationTime(simTime());
+    wsm->setDone(stopSendingHello);
+
+    if (implicitAcks) {
+        // Piggyback everyone we have heard from; receivers find their own bit
+        int numBytes = heardFrom.byteCount();
+        wsm->setHeardFromArraySize(numBytes);
+        for (int i = 0; i < numBytes; i++) {
+            wsm->setHeardFrom(i, heardFrom.byteAt(i));
+        }
+        wsm->addByteLength(HELLO_BITMAP_HEADER_BYTES + numBytes);
+    }
 
     // Broadcast HELLO
     wsm->setRecipientAddress(-1);
     sendDown(wsm);
 
-    std::cout << simTime() << " V" << myId
-       << " TX HELLO #" << helloAttempts
-       << " acked=" << setToString(ackedSet)
-       << " pending=" << pendingAckToString()
-       << std::endl;
-
-    EV << simTime() << " V" << myId
-       << " TX HELLO #" << helloAttempts
-       << " acked=" << setToString(ackedSet)
-       << " pending=" << pendingAckToString()
-       << "\n";
+    helloFramesSent++;
+    lastHelloSent = simTime();
+    SentHello& sent = sentHellos[helloAttempts % HELLO_HISTORY];
+    sent.seq = helloAttempts;
+    sent.time = simTime();
+    emit(helloSentSignal, helloAttempts);
 }
 
-void HelloWaveApplication::sendAck(int targetId)
+void HelloWaveApplication::completeProtocol()
 {
-    // ACK is broadcast, target is encoded in name
-    std::string msgName =
-        "ACK_from_" + std::to_string(myId) + "_to_" + std::to_string(targetId);
+    stopSendingHello = true;
+    if (helloEvent->isScheduled()) cancelEvent(helloEvent);
+
+    endTime = simTime();
+    double duration = (endTime - startTime).dbl();
+    emit(completionTimeSignal, endTime - startTime);
+    if (coordinator) coordinator->reportCompleted(myId);
+
+    PROTOCOL_LOG(PLOG_SUMMARY, ProtocolEvent::COMPLETED, myId, -1, helloAttempts, helloFramesSent + ackFramesSent, duration);
+
+    // Peers only learn that we heard them from our HELLOs, so advertise the final set once
+    if (implicitAcks) broadcastHello();
+}
 
-    BaseFrame1609_4* wsm = new BaseFrame1609_4(msgName.c_str());
+void HelloWaveApplication::sendAck(int targetId)
+{
+    // ACK is broadcast, target is carried in the header
+    HelloWaveMessage* wsm = new HelloWaveMessage("ACK");
     populateWSM(wsm);
+    wsm->addByteLength(HELLO_PACKET_BYTES);
+    wsm->setType(HELLO_MSG_ACK);
+    wsm->setSenderId(myId);
+    wsm->setTargetId(targetId);
+    wsm->setSequenceNumber(ackSeq[targetId]);
+    wsm->setCreationTime(simTime());
 
     wsm->setRecipientAddress(-1);
     sendDown(wsm);
 
-    EV << simTime() << " V" << myId
-       << " TX ACK(to=" << targetId << ") name=" << msgName << "\n";
+    ackFramesSent++;
+    emit(ackSentSignal, targetId);
+
+    PROTOCOL_LOG(PLOG_EVENTS, ProtocolEvent::ACK_TX, myId, targetId);
 }
 
-void HelloWaveApplication::processHello(BaseFrame1609_4* wsm)
+void HelloWaveApplication::processHello(HelloWaveMessage* wsm)
 {
-    int senderId = parseSenderId(wsm->getName());
+    int senderId = wsm->getSenderId();
     if (senderId < 0 || senderId == myId) return;
 
+    PROTOCOL_LOG(PLOG_EVENTS, ProtocolEvent::HELLO_RX, myId, senderId, wsm->getSequenceNumber());
+    emit(helloReceivedSignal, senderId);
+
+    if (implicitAcks) {
+        processImplicitAck(wsm);
+        return;
+    }
+
     // IMPORTANT: ACK each sender only once (prevents ACK storms)
-    if (ackSentTo.count(senderId)) return;
-    ackSentTo.insert(senderId);
+    if (!ackSentTo.insert(senderId)) return;
+    ackSeq[senderId] = wsm->getSequenceNumber();
+
+    // Aggregated: collect targets for one ACK at the end of the backoff window, or as soon as the list is full
+    if (aggregatedAcks) {
+        pendingAckTargets.push_back(senderId);
+        if ((int)pendingAckTargets.size() >= maxAckTargets) {
+            cancelEvent(ackBatchEvent);
+            sendAggregatedAck();
+        }
+        else if (!ackBatchEvent->isScheduled()) {
+            scheduleAt(simTime() + uniform(0, ackBackoffMax), ackBatchEvent);
+        }
+        return;
+    }
 
     // Random backoff before ACK to reduce collisions across receivers
-    if (!ackTimers.count(senderId)) {
-        cMessage* t = new cMessage("ackTimer");
-        ackTimers[senderId] = t;
-        scheduleAt(simTime() + uniform(0, ackBackoffMax), t);
+    scheduleAck(senderId, uniform(0, ackBackoffMax));
+}
+
+void HelloWaveApplication::scheduleAck(int targetId, simtime_t delay)
+{
+    cMessage* t;
+    if (!freeAckTimers.empty()) {
+        t = freeAckTimers.back();
+        freeAckTimers.pop_back();
+    }
+    else {
+        t = new cMessage("ackTimer", ACK_TIMER_KIND);
+        ackTimers.push_back(t);
     }
 
-    EV << simTime() << " V" << myId
-       << " RX HELLO from " << senderId
-       << " -> schedule ACK backoff<= " << ackBackoffMax << "s\n";
+    t->setContextPointer((void*)(intptr_t)targetId);
+    scheduleAt(simTime() + delay, t);
 }
 
-void HelloWaveApplication::processAck(BaseFrame1609_4* wsm)
+void HelloWaveApplication::updateDcc()
 {
-    std::string msgName = wsm->getName();
+    double cbr = dcc->update();
+    emit(channelBusyRatioSignal, cbr);
+    emit(helloIntervalSignal, dcc->getInterval());
 
-    // Parse "ACK_from_X_to_Y"
-    size_t toPos = msgName.find("_to_");
-    if (toPos == std::string::npos) return;
+    if (mac1609) mac1609->setTxPower(maxTxPower * dcc->getPowerFactor());
+}
 
-    int targetId = -1;
-    try {
-        targetId = std::stoi(msgName.substr(toPos + 4));
-    } catch (...) {
-        return;
-    }
+void HelloWaveApplication::sendAggregatedAck()
+{
+    int n = std::min((int)pendingAckTargets.size(), maxAckTargets);
+    if (n == 0) return;
 
-    // Not for me -> ignore
-    if (targetId != myId) return;
+    HelloWaveMessage* wsm = new HelloWaveMessage("ACK");
+    populateWSM(wsm);
+    wsm->addByteLength(HELLO_PACKET_BYTES + ACK_TARGETS_HEADER_BYTES + n * ACK_TARGET_BYTES);
+    wsm->setType(HELLO_MSG_ACK);
+    wsm->setSenderId(myId);
+    wsm->setTargetId(-1);
+    wsm->setCreationTime(simTime());
+    wsm->setTargetsArraySize(n);
+    for (int i = 0; i < n; i++) {
+        wsm->setTargets(i, pendingAckTargets[i]);
+    }
 
-    int senderId = parseSenderId(msgName.c_str());
-    if (senderId < 0 || senderId == myId) return;
+    wsm->setRecipientAddress(-1);
+    sendDown(wsm);
 
-    // Only act when new
-    if (ackedSet.find(senderId) == ackedSet.end()) {
-        ackedSet.insert(senderId);
+    ackFramesSent++;
+    emit(ackSentSignal, -1);
+    emit(ackTargetsSignal, n);
 
-        EV << simTime() << " V" << myId
-           << " RX ACK from " << senderId
-           << " acked=" << setToString(ackedSet)
-           << " pending=" << pendingAckToString()
-           << "\n";
+    PROTOCOL_LOG(PLOG_EVENTS, ProtocolEvent::ACK_TX, myId, -1, n);
 
-        // If everyone acked me, stop sending (completion will be printed by next sendHello() check
-        // BUT we can also complete immediately here for faster log)
-        if ((int)ackedSet.size() >= TOTAL_VEHICLES && !stopSendingHello) {
-            stopSendingHello = true;
-            if (helloEvent->isScheduled()) cancelEvent(helloEvent);
-
-            endTime = simTime();
-            double duration = (endTime - startTime).dbl();
-
-            std::cout << simTime() << " V" << myId
-                      << " COMPLETED attempts=" << helloAttempts
-                      << " duration=" << duration << "s"
-                      << " acked=" << ackedSet.size() << "/" << TOTAL_VEHICLES
-                      << std::endl;
-        }
-    }
+    // Whatever did not fit goes out after another backoff
+    pendingAckTargets.erase(pendingAckTargets.begin(), pendingAckTargets.begin() + n);
+    if (!pendingAckTargets.empty()) scheduleAt(simTime() + uniform(0, ackBackoffMax), ackBatchEvent);
 }
 
-int HelloWaveApplication::parseSenderId(const char* name) const
+void HelloWaveApplication::processImplicitAck(HelloWaveMessage* wsm)
 {
-    std::string s(name);
-
-    // Works for both:
-    // "HELLO_from_X"
-    // "ACK_from_X_to_Y"
-    size_t pos = s.find("from_");
-    if (pos == std::string::npos) return -1;
+    int senderId = wsm->getSenderId();
+    heardFrom.insert(senderId);
 
-    size_t start = pos + 5;
-    size_t end = s.find("_", start);
-
-    std::string idStr = (end == std::string::npos) ? s.substr(start)
-                                                   : s.substr(start, end - start);
+    // Our own bit in the sender's heard-from bitmap is the ACK
+    size_t byte = myId >> 3;
+    if (byte < wsm->getHeardFromArraySize() && ((wsm->getHeardFrom(byte) >> (myId & 7)) & 1)) {
+        markAcked(senderId);
+    }
 
-    try {
-        return std::stoi(idStr);
-    } catch (...) {
-        return -1;
+    // A sender that is still handshaking may not have seen itself in our HELLOs yet.
+    // Answer with at most one HELLO per basePeriod; completed senders are not answered,
+    // or two completed vehicles would keep answering each other.
+    if (stopSendingHello && !wsm->getDone() && !helloEvent->isScheduled()) {
+        simtime_t delay = lastHelloSent + basePeriod - simTime();
+        if (delay < SimTime(0)) delay = SimTime(0);
+        scheduleHello(delay + uniform(0, jitter));
     }
 }
 
-std::string HelloWaveApplication::setToString(const std::set<int>& s) const
+void HelloWaveApplication::processAck(HelloWaveMessage* wsm)
 {
-    std::string out = "{";
-    bool first = true;
-    for (int x : s) {
-        if (!first) out += ",";
-        out += std::to_string(x);
-        first = false;
+    // Not for me -> ignore
+    if (wsm->getTargetsArraySize() > 0) {
+        bool listed = false;
+        for (size_t i = 0; i < wsm->getTargetsArraySize() && !listed; i++) {
+            listed = wsm->getTargets(i) == myId;
+        }
+        if (!listed) return;
+    }
+    else if (wsm->getTargetId() != myId) return;
+
+    int senderId = wsm->getSenderId();
+    if (senderId < 0 || senderId == myId) return;
+
+    // Per-target ACKs echo the sequence number of the HELLO they answer
+    if (wsm->getTargetsArraySize() == 0) {
+        const SentHello& sent = sentHellos[wsm->getSequenceNumber() % HELLO_HISTORY];
+        if (sent.seq == wsm->getSequenceNumber() && sent.time >= SIMTIME_ZERO) rttHistograms.record(senderId, simTime() - sent.time);
     }
-    out += "}";
-    return out;
+
+    markAcked(senderId);
 }
 
-std::string HelloWaveApplication::pendingAckToString() const
+void HelloWaveApplication::markAcked(int senderId)
 {
-    std::string out = "{";
-    bool first = true;
-    for (int id = 0; id < TOTAL_VEHICLES; id++) {
-        if (ackedSet.find(id) == ackedSet.end()) {
-            if (!first) out += ",";
-            out += std::to_string(id);
-            first = false;
+    // Only act when new
+    if (ackedSet.insert(senderId)) {
+
+        PROTOCOL_LOG(PLOG_EVENTS, ProtocolEvent::ACK_RX, myId, senderId, 0, ackedSet.count());
+        emit(ackReceivedSignal, senderId);
+        if (neighborTable) neighborTable->reportDiscovered(myId, senderId);
+        if (coordinator) coordinator->reportProgress(myId);
+
+        // If everyone acked me, stop sending (completion will be printed by next sendHello() check
+        // BUT we can also complete immediately here for faster log)
+        if (!stopSendingHello && isComplete()) {
+            completeProtocol();
         }
     }
-    out += "}";
-    return out;
+}
+
+bool HelloWaveApplication::isComplete()
+{
+    if (!inRangeCompletion) return ackedSet.full();
+
+    // Every peer currently in range has acked; with nobody in range there is nothing to complete yet
+    neighborTable->getNeighbors(myId, expectedPeers);
+    return expectedPeers.count() > 0 && ackedSet.containsAll(expectedPeers);
 }
 
 void HelloWaveApplication::finish()
 {
-    // Optional: print a clean timeout summary if not completed
-    if ((int)ackedSet.size() < TOTAL_VEHICLES) {
-        std::cout << simTime() << " V" << myId
-                  << " TIMEOUT attempts=" << helloAttempts
-                  << " acked=" << ackedSet.size() << "/" << TOTAL_VEHICLES
-                  << " pending=" << pendingAckToString()
-                  << std::endl;
+    recordScalar("framesSent", helloFramesSent + ackFramesSent);
+    rttHistograms.recordScalars(this, "rtt");
+    oneWayHistograms.recordScalars(this, "oneWayLatency");
+
+    emit(helloAttemptsSignal, helloAttempts);
+    if (neighborTable) neighborTable->unregisterVehicle(myId);
+
+    emit(timedOutSignal, !stopSendingHello);
+    if (!stopSendingHello) {
+        PROTOCOL_LOG(PLOG_SUMMARY, ProtocolEvent::TIMEOUT, myId, -1, helloAttempts, ackedSet.count());
     }
 
     if (helloEvent) {
         cancelAndDelete(helloEvent);
         helloEvent = nullptr;
     }
+    if (ackBatchEvent) {
+        cancelAndDelete(ackBatchEvent);
+        ackBatchEvent = nullptr;
+    }
+    if (dcc) {
+        getParentModule()->unsubscribe("org_car2x_veins_modules_mac_sigChannelBusy", dcc);
+        cancelAndDelete(dccEvent);
+        dccEvent = nullptr;
+        delete dcc;
+        dcc = nullptr;
+    }
 
-    for (auto& kv : ackTimers) {
-        cancelAndDelete(kv.second);
+    for (cMessage* t : ackTimers) {
+        cancelAndDelete(t);
     }
     ackTimers.clear();
+    freeAckTimers.clear();
 
     DemoBaseApplLayer::finish();
 }
@@ -1,10 +1,17 @@
 #pragma once
-#include <set>
 #include <string>
-#include <map>
+#include <vector>
 #include "veins/modules/application/ieee80211p/DemoBaseApplLayer.h"
+#include "common/LatencyHistogram.h"
+#include "common/PeerSet.h"
+#include "wave/DccController.h"
 using namespace veins;
 
+class HelloWaveMessage;
+class CompletionCoordinator;
+class NeighborTable;
+namespace veins { class Mac1609_4; }
+
 class HelloWaveApplication : public DemoBaseApplLayer
 {
   public:
@@ -18,7 +25,13 @@ class HelloWaveApplication : public DemoBaseApplLayer
 
   private:
     // ====== CONFIG ======
-    static constexpr int TOTAL_VEHICLES = 4;
+    int totalVehicles = 4;                          // NED parameter numVehicles
+    bool implicitAcks = false;                      // NED parameter ackMode
+    bool aggregatedAcks = false;                    // NED parameter ackMode
+    int maxAckTargets = 16;                         // NED parameter maxAckTargets
+    simtime_t dccInterval;                          // NED parameter dccInterval
+    bool dccTxPower = false;                        // NED parameter dccTxPower
+    bool inRangeCompletion = false;                 // NED parameter completion
     // Base HELLO period and jitter
     const simtime_t basePeriod = SimTime(0.1);    // 100ms
     const simtime_t jitter     = SimTime(0.005);  // 5ms
@@ -36,27 +49,78 @@ class HelloWaveApplication : public DemoBaseApplLayer
     bool stopSendingHello = false;
 
     // Who has ACKed *my* HELLOs
-    std::set<int> ackedSet;
+    PeerSet ackedSet;
     cMessage* helloEvent = nullptr;
 
     // ACK de-duplication: only ACK each sender once
-    std::set<int> ackSentTo;
+    PeerSet ackSentTo;
+    std::vector<uint32_t> ackSeq;  // by sender: sequence number of the HELLO our ACK answers
+
+    // Delayed ACK timers: kind ACK_TIMER_KIND, target id in the context pointer.
+    // Fired timers go back to the free list, so steady state allocates nothing.
+    enum { ACK_TIMER_KIND = 100 };  // clear of DemoBaseApplLayer's SEND_BEACON_EVT/SEND_WSA_EVT
+    std::vector<cMessage*> ackTimers;      // every timer ever allocated (owned)
+    std::vector<cMessage*> freeAckTimers;  // not scheduled, ready for reuse
+
+    // Aggregated ACK mode: targets collected during the current backoff window
+    std::vector<int> pendingAckTargets;
+    cMessage* ackBatchEvent = nullptr;
+
+    // Who I have received a HELLO from (implicit ACK mode)
+    PeerSet heardFrom;
+    simtime_t lastHelloSent;
 
-    // Delayed ACK timers: senderId -> timer
-    std::map<int, cMessage*> ackTimers;
+    CompletionCoordinator* coordinator = nullptr;  // NED parameter coordinatorModule, may be null
+    NeighborTable* neighborTable = nullptr;        // NED parameter neighborTableModule, may be null
+    PeerSet expectedPeers;                         // in-range peers at the last completion check
+
+    // Congestion control (NED parameter dcc), null when off
+    DccController* dcc = nullptr;
+    cMessage* dccEvent = nullptr;
+    veins::Mac1609_4* mac1609 = nullptr;
+    double maxTxPower = 0;                          // mW, the MAC's configured txPower
 
     // ====== BENCHMARKING ======
     int helloAttempts = 0;
+    long helloFramesSent = 0;
+    long ackFramesSent = 0;
     simtime_t startTime;
     simtime_t endTime;
 
+    // Send times of the last HELLOs by sequence number, to match ACKs (which echo it) for the RTT
+    static const int HELLO_HISTORY = 64;
+    struct SentHello
+    {
+        uint32_t seq = 0;
+        simtime_t time = -1;
+    };
+    SentHello sentHellos[HELLO_HISTORY];
+    PeerLatencyHistograms rttHistograms;     // HELLO sent -> its ACK received, by ACK sender (per-target ACKs only)
+    PeerLatencyHistograms oneWayHistograms;  // HELLO/ACK creation -> received, by sender
+
+    static const simsignal_t helloSentSignal;
+    static const simsignal_t helloReceivedSignal;
+    static const simsignal_t ackSentSignal;
+    static const simsignal_t ackReceivedSignal;
+    static const simsignal_t ackTargetsSignal;
+    static const simsignal_t channelBusyRatioSignal;
+    static const simsignal_t helloIntervalSignal;
+    static const simsignal_t completionTimeSignal;
+    static const simsignal_t helloAttemptsSignal;
+    static const simsignal_t timedOutSignal;
+
   private:
     void scheduleHello(simtime_t delay);
     void sendHello();
+    void broadcastHello();
+    void completeProtocol();
     void sendAck(int targetId);
-    void processHello(BaseFrame1609_4* wsm);
-    void processAck(BaseFrame1609_4* wsm);
-    int parseSenderId(const char* name) const;
-    std::string setToString(const std::set<int>& s) const;
-    std::string pendingAckToString() const;
+    void scheduleAck(int targetId, simtime_t delay);
+    void sendAggregatedAck();
+    void updateDcc();
+    void processHello(HelloWaveMessage* wsm);
+    void processImplicitAck(HelloWaveMessage* wsm);
+    void processAck(HelloWaveMessage* wsm);
+    void markAcked(int senderId);
+    bool isComplete();
 };
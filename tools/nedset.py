@@ -0,0 +1,292 @@
+#!/usr/bin/env python3
+"""Compute the NED files our networks actually need and emit them as a minimal NED path.
+
+Scans every NED file under the given NED source folders, then follows, starting from
+the networks, every type a needed type refers to: extends/like lists, submodule and
+channel types, and type names in string literals (typename defaults, like-submodule
+types, moduleType parameters). Type names in the ini files count too, as quoted
+strings or as bare identifier values (typename = IntegratedOsgVisualizer).
+Unqualified names in NED are resolved like the NED compiler does (same package,
+imports incl. wildcards); names in strings match every type of that simple name, as
+for "like" submodules.
+
+The needed files of the --emit folders are symlinked into OUT/<n>/ with the same
+layout, together with the package.ned files on their way, and the resulting NED path
+is written to OUT/nedpath. Folders that are only scanned (ours) are loaded as before.
+
+    tools/nedset.py -o out/nedset --ini simulations/*/omnetpp.ini \\
+        --scan src --scan simulations --emit ../inet/src --emit ../veins/src/veins
+"""
+
+import argparse
+import glob
+import os
+import re
+import shutil
+import sys
+
+DECL_KEYWORDS = ("simple", "module", "network", "channel", "moduleinterface", "channelinterface")
+
+TOKEN_RE = re.compile(r'"(?:[^"\\\n]|\\.)*"|[A-Za-z_][\w.*]*|::|\S')
+
+
+def strip_comments(text):
+    out = []
+    for line in text.splitlines():
+        in_string = False
+        i = 0
+        while i < len(line):
+            c = line[i]
+            if c == '"' and (i == 0 or line[i - 1] != "\\"):
+                in_string = not in_string
+            elif not in_string and line.startswith("//", i):
+                line = line[:i]
+                break
+            i += 1
+        out.append(line)
+    return "\n".join(out)
+
+
+class NedType:
+    def __init__(self, name, kind, path):
+        self.name = name        # fully qualified
+        self.kind = kind
+        self.path = path
+        self.tokens = []        # identifiers and string literals of header and body
+
+    @property
+    def simple_name(self):
+        return self.name.rsplit(".", 1)[-1]
+
+
+class NedFile:
+    def __init__(self, path, root):
+        self.path = path
+        self.root = root
+        self.package = ""
+        self.imports = []
+        self.types = []
+
+
+def parse_ned(path, root):
+    with open(path, encoding="utf-8", errors="replace") as f:
+        tokens = TOKEN_RE.findall(strip_comments(f.read()))
+
+    ned = NedFile(path, root)
+    depth = 0
+    current = None
+    i = 0
+    while i < len(tokens):
+        tok = tokens[i]
+        if depth == 0 and current is None:
+            if tok == "package" and i + 1 < len(tokens):
+                ned.package = tokens[i + 1]
+                i += 2
+                continue
+            if tok == "import" and i + 1 < len(tokens):
+                ned.imports.append(tokens[i + 1])
+                i += 2
+                continue
+            if tok in DECL_KEYWORDS and i + 1 < len(tokens) and re.match(r"[A-Za-z_]\w*$", tokens[i + 1]):
+                name = tokens[i + 1]
+                current = NedType(ned.package + "." + name if ned.package else name, tok, path)
+                ned.types.append(current)
+                i += 2
+                continue
+        if tok == "{":
+            depth += 1
+        elif tok == "}":
+            depth -= 1
+            if depth == 0 and current is not None:
+                current = None
+        elif tok == ";" and depth == 0:
+            current = None
+        elif current is not None and (tok[0] == '"' or tok[0].isalpha() or tok[0] == "_"):
+            current.tokens.append(tok)
+        i += 1
+    return ned
+
+
+def import_matches(pattern, name):
+    regex = re.escape(pattern).replace(r"\*\*", ".*").replace(r"\*", "[^.]*")
+    return re.fullmatch(regex, name) is not None
+
+
+class NedIndex:
+    def __init__(self):
+        self.files = []
+        self.types = {}          # qualified name -> NedType
+        self.by_simple = {}      # simple name -> [NedType]
+        self.file_of = {}        # path -> NedFile
+
+    def add(self, ned):
+        self.files.append(ned)
+        self.file_of[ned.path] = ned
+        for t in ned.types:
+            self.types[t.name] = t
+            self.by_simple.setdefault(t.simple_name, []).append(t)
+
+    def resolve_identifier(self, ned, name):
+        if name in self.types:
+            return [self.types[name]]
+        if "." in name or "*" in name:
+            return []
+        found = []
+        for imp in ned.imports:
+            if imp.rsplit(".", 1)[-1] in (name, "*", "**") or "*" in imp:
+                for t in self.by_simple.get(name, []):
+                    if import_matches(imp, t.name):
+                        found.append(t)
+        local = (ned.package + "." + name) if ned.package else name
+        if local in self.types:
+            found.append(self.types[local])
+        return found
+
+    def resolve_string(self, value):
+        if not re.fullmatch(r"[A-Za-z_][\w.]*", value):
+            return []
+        if value in self.types:
+            return [self.types[value]]
+        return list(self.by_simple.get(value, []))
+
+    def references(self, t):
+        ned = self.file_of[t.path]
+        for tok in t.tokens:
+            if tok[0] == '"':
+                yield from self.resolve_string(tok[1:-1])
+            else:
+                yield from self.resolve_identifier(ned, tok)
+
+
+def find_ned_files(root):
+    for dirpath, dirnames, filenames in os.walk(root):
+        dirnames[:] = sorted(d for d in dirnames if not d.startswith("."))
+        for name in sorted(filenames):
+            if name.endswith(".ned"):
+                yield os.path.join(dirpath, name)
+
+
+def read_ini(path, seen=None):
+    """String values and network names of an ini file and the files it includes"""
+    seen = seen if seen is not None else set()
+    path = os.path.abspath(path)
+    if path in seen:
+        return [], []
+    seen.add(path)
+    strings, networks = [], []
+    with open(path, encoding="utf-8", errors="replace") as f:
+        for line in f:
+            line = line.split("#", 1)[0].strip()
+            m = re.match(r"include\s+(\S+)", line)
+            if m:
+                s, n = read_ini(os.path.join(os.path.dirname(path), m.group(1)), seen)
+                strings += s
+                networks += n
+                continue
+            m = re.match(r"network\s*=\s*\"?([\w.]+)\"?$", line)
+            if m:
+                networks.append(m.group(1))
+            strings += re.findall(r'"([A-Za-z_][\w.]*)"', line)
+            # Unquoted values, e.g. "**.typename = IntegratedOsgVisualizer"
+            m = re.match(r"[^=\s]+\s*=\s*([A-Za-z_][\w.]*)$", line)
+            if m:
+                strings.append(m.group(1))
+    return strings, networks
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("-o", "--output", required=True, help="output folder, replaced on every run")
+    parser.add_argument("--scan", action="append", default=[], help="NED folder that is scanned but loaded as it is (ours)")
+    parser.add_argument("--emit", action="append", default=[], help="NED folder to emit a minimal copy of (INET, Veins)")
+    parser.add_argument("--ini", action="append", default=[], help="ini file; its networks and string values are roots")
+    parser.add_argument("--network", action="append", default=[], help="additional network (or any type) to keep")
+    args = parser.parse_args()
+
+    roots = [os.path.abspath(r) for r in args.scan + args.emit]
+    emit_roots = [os.path.abspath(r) for r in args.emit]
+    for root in roots:
+        if not os.path.isdir(root):
+            sys.exit("nedset: no such NED folder: %s" % root)
+
+    index = NedIndex()
+    for root in roots:
+        for path in find_ned_files(root):
+            index.add(parse_ned(path, root))
+
+    # Roots of the closure
+    pending = []
+    for ini in args.ini:
+        strings, networks = read_ini(ini)
+        ini_dir = os.path.dirname(os.path.abspath(ini))
+        for name in networks:
+            candidates = index.resolve_string(name)
+            same_dir = [t for t in candidates if os.path.dirname(t.path) == ini_dir]
+            if not candidates:
+                sys.exit("nedset: network %s of %s not found" % (name, ini))
+            pending += same_dir or candidates
+        for value in strings:
+            pending += index.resolve_string(value)
+    for name in args.network:
+        found = index.resolve_string(name)
+        if not found:
+            sys.exit("nedset: type %s not found" % name)
+        pending += found
+    if not pending:
+        sys.exit("nedset: nothing to start from, give --ini or --network")
+
+    needed = set()
+    while pending:
+        t = pending.pop()
+        if t.name in needed:
+            continue
+        needed.add(t.name)
+        pending.extend(r for r in index.references(t) if r.name not in needed)
+
+    needed_files = {index.types[name].path for name in needed}
+
+    if os.path.isdir(args.output):
+        shutil.rmtree(args.output)
+    os.makedirs(args.output)
+
+    ned_path = []
+    emitted = 0
+    total = 0
+    for n, root in enumerate(emit_roots):
+        out_root = os.path.abspath(os.path.join(args.output, str(n)))
+        ned_path.append(out_root)
+        files = set()
+        for ned in index.files:
+            if ned.root != root:
+                continue
+            total += 1
+            if ned.path not in needed_files:
+                continue
+            files.add(ned.path)
+            # package.ned files carry the package and @namespace of everything below them
+            d = os.path.dirname(ned.path)
+            while True:
+                package_ned = os.path.join(d, "package.ned")
+                if os.path.isfile(package_ned):
+                    files.add(package_ned)
+                if d == root:
+                    break
+                d = os.path.dirname(d)
+        for path in sorted(files):
+            target = os.path.join(out_root, os.path.relpath(path, root))
+            os.makedirs(os.path.dirname(target), exist_ok=True)
+            os.symlink(path, target)
+        emitted += len(files)
+        os.makedirs(out_root, exist_ok=True)
+
+    with open(os.path.join(args.output, "nedpath"), "w") as f:
+        f.write(":".join(ned_path) + "\n")
+    with open(os.path.join(args.output, "types.txt"), "w") as f:
+        for name in sorted(needed):
+            f.write("%s\t%s\n" % (name, index.types[name].path))
+
+    print("nedset: %d types; %d of %d NED files emitted to %s" % (len(needed), emitted, total, args.output))
+
+
+if __name__ == "__main__":
+    main()